@@ -0,0 +1,117 @@
+/** vim: set noet ci pi sts=0 sw=4 ts=4
+ * @file FrameScan.c
+ * @brief Compares the delimiter scanners of the framed reader on CRLF
+ * terminated lines of several lengths.
+ *
+ * Usage: FrameScan [megabytes]. Every line length is scanned that many
+ * megabytes over, in a buffer that is small enough to stay in the cache, by
+ * a plain byte at a time loop and by each scanner the processor supports.
+ */
+
+#include "../Frame.h"
+#include "../Time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BufferSize (256 * 1024)
+
+static const uint8 delimiter[] = { '\r', '\n' };
+
+/* what the protocols did before: look at every byte */
+static const uint8* FindBytewise(const uint8* data, uint32 length, const uint8* const delimiter, uint8 delimiterLength) {
+	uint32 i;
+
+	for (i = 0; i + delimiterLength <= length; i++)
+		if (data[i] == delimiter[0] && memcmp(data + i + 1, delimiter + 1, delimiterLength - 1) == 0)
+			return data + i;
+
+	return NULL;
+}
+
+/* fills @a buffer with lines of @a lineLength bytes, delimiter included, and returns how many fit */
+static uint32 FillLines(uint8* buffer, uint32 lineLength) {
+	uint32 lines;
+	uint32 i;
+	uint32 j;
+
+	lines = BufferSize / lineLength;
+
+	for (i = 0; i < lines; i++) {
+		for (j = 0; j < lineLength - 2; j++)
+			buffer[i * lineLength + j] = (uint8)('a' + (i + j) % 26);
+
+		buffer[i * lineLength + lineLength - 2] = '\r';
+		buffer[i * lineLength + lineLength - 1] = '\n';
+	}
+
+	return lines;
+}
+
+/* finds every line in @a buffer @a rounds times over and returns the throughput in MB/s, or 0 if a line was missed */
+static double Measure(const uint8* (*find)(const uint8*, uint32, const uint8* const, uint8), const uint8* buffer, uint32 lines, uint32 lineLength, uint32 rounds) {
+	const uint8* position;
+	const uint8* end;
+	const uint8* found;
+	int64 started;
+	int64 elapsed;
+	uint32 seen;
+	uint32 i;
+
+	end = buffer + lines * lineLength;
+	started = SAL_Time_Now();
+
+	for (i = 0; i < rounds; i++) {
+		for (position = buffer, seen = 0; (found = find(position, (uint32)(end - position), delimiter, sizeof(delimiter))) != NULL; seen++)
+			position = found + sizeof(delimiter);
+
+		if (seen != lines)
+			return 0;
+	}
+
+	elapsed = SAL_Time_Now() - started;
+	if (elapsed == 0)
+		elapsed = 1;
+
+	return (double)lines * lineLength * rounds / (1024.0 * 1024.0) / ((double)elapsed / 1000.0);
+}
+
+int main(int argc, char** argv) {
+	static const uint32 lineLengths[] = { 16, 64, 256, 1024, 4096 };
+	static const char* const names[] = { "portable", "sse2", "avx2" };
+	uint8* buffer;
+	uint32 megabytes;
+	uint32 lines;
+	uint32 rounds;
+	uint32 i;
+	uint8 scanner;
+	uint8 widest;
+
+	megabytes = argc > 1 ? (uint32)atoi(argv[1]) : 2048;
+	buffer = (uint8*)malloc(BufferSize);
+	widest = SAL_Frame_SetScanner(SAL_Frame_Scanners_AVX2);
+
+	printf("%-8s %12s", "line", "bytewise");
+	for (scanner = SAL_Frame_Scanners_Portable; scanner <= widest; scanner++)
+		printf(" %12s", names[scanner]);
+	printf("   (MB/s)\n");
+
+	for (i = 0; i < sizeof(lineLengths) / sizeof(lineLengths[0]); i++) {
+		lines = FillLines(buffer, lineLengths[i]);
+		rounds = (uint32)((uint64)megabytes * 1024 * 1024 / (lines * lineLengths[i]));
+
+		printf("%-8u %12.0f", lineLengths[i], Measure(FindBytewise, buffer, lines, lineLengths[i], rounds));
+
+		for (scanner = SAL_Frame_Scanners_Portable; scanner <= widest; scanner++) {
+			SAL_Frame_SetScanner(scanner);
+			printf(" %12.0f", Measure(SAL_Frame_Find, buffer, lines, lineLengths[i], rounds));
+		}
+
+		printf("\n");
+	}
+
+	free(buffer);
+
+	return 0;
+}
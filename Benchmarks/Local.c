@@ -0,0 +1,163 @@
+/** vim: set noet ci pi sts=0 sw=4 ts=4
+ * @file Local.c
+ * @brief Compares local sockets with loopback TCP for latency and
+ * throughput between two threads of the same process.
+ *
+ * Usage: Local [round trips] [megabytes] [message size] [port]. Latency is
+ * the average time for a message of message size bytes to be sent and echoed
+ * back, over that many round trips. Throughput is that many megabytes sent
+ * one way in 64KB writes, timed until the receiver has read them all. The
+ * TCP listener is on port; pick another if a previous run's connection is
+ * still holding it.
+ */
+
+#include "../Socket.h"
+#include "../Thread.h"
+#include "../Time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ChunkSize (64 * 1024)
+
+#ifdef POSIX
+	#define LocalName "@SAL-Local-Benchmark"
+#else
+	#define LocalName "SAL-Local-Benchmark.sock"
+#endif
+
+static uint32 roundTrips;
+static uint64 bytes;
+static uint32 messageSize;
+
+/* reads exactly @a length bytes, however the transport splits them up */
+static boolean ReadAll(SAL_Socket* socket, uint8* buffer, uint32 length) {
+	uint32 read;
+
+	while (length > 0) {
+		read = SAL_Socket_Read(socket, buffer, length);
+		if (read == 0)
+			return false;
+
+		buffer += read;
+		length -= read;
+	}
+
+	return true;
+}
+
+/* the other end: echoes every message of the latency run, then reads the throughput run through and acknowledges it */
+static SAL_Thread_Start(Serve) {
+	SAL_Socket* socket;
+	uint8* buffer;
+	uint64 received;
+	uint32 read;
+	uint32 i;
+
+	socket = (SAL_Socket*)startupArgument;
+	buffer = malloc(ChunkSize);
+
+	for (i = 0; i < roundTrips; i++) {
+		if (!ReadAll(socket, buffer, messageSize))
+			break;
+
+		SAL_Socket_Write(socket, buffer, messageSize);
+	}
+
+	for (received = 0; received < bytes; received += read) {
+		read = SAL_Socket_Read(socket, buffer, ChunkSize);
+		if (read == 0)
+			break;
+	}
+
+	SAL_Socket_Write(socket, buffer, 1);
+
+	free(buffer);
+
+	return 0;
+}
+
+static void Run(const char* label, const int8* const address, const int8* const port, uint8 family, uint8 type) {
+	SAL_Socket* listener;
+	SAL_Socket* client;
+	SAL_Socket* server;
+	SAL_Thread thread;
+	uint8* buffer;
+	uint64 sent;
+	int64 started;
+	int64 latencyTime;
+	int64 throughputTime;
+	uint32 i;
+
+	listener = SAL_Socket_Listen(port, family, type);
+	client = listener != NULL ? SAL_Socket_Connect(address, port, family, type) : NULL;
+	server = client != NULL ? SAL_Socket_Accept(listener) : NULL;
+
+	if (server == NULL) {
+		printf("%-22s unavailable\n", label);
+
+		if (client != NULL)
+			SAL_Socket_Close(client);
+		if (listener != NULL)
+			SAL_Socket_Close(listener);
+
+		return;
+	}
+
+	buffer = malloc(ChunkSize);
+	memset(buffer, 0x5A, ChunkSize);
+
+	thread = SAL_Thread_Create(Serve, server);
+
+	started = SAL_Time_Now();
+
+	for (i = 0; i < roundTrips; i++) {
+		SAL_Socket_Write(client, buffer, messageSize);
+		if (!ReadAll(client, buffer, messageSize))
+			break;
+	}
+
+	latencyTime = SAL_Time_Now() - started;
+	started = SAL_Time_Now();
+
+	/* the last write is cut short so that exactly @a bytes are sent; a message socket receives it as a message of its own */
+	for (sent = 0; sent < bytes; sent += ChunkSize)
+		SAL_Socket_Write(client, buffer, bytes - sent < ChunkSize ? (uint32)(bytes - sent) : ChunkSize);
+
+	ReadAll(client, buffer, 1);
+
+	throughputTime = SAL_Time_Now() - started;
+
+	SAL_Thread_Join(thread);
+
+	printf("%-22s %10.2f us %10.0f MB/s\n", label, (double)latencyTime * 1000.0 / roundTrips, throughputTime > 0 ? (double)bytes / 1048576.0 * 1000.0 / (double)throughputTime : 0.0);
+
+	free(buffer);
+	SAL_Socket_Close(server);
+	SAL_Socket_Close(client);
+	SAL_Socket_Close(listener);
+}
+
+int main(int argc, char** argv) {
+	const int8* port;
+
+	roundTrips = argc > 1 ? (uint32)atoi(argv[1]) : 50000;
+	bytes = (argc > 2 ? (uint64)atoi(argv[2]) : 2048) * 1048576;
+	messageSize = argc > 3 ? (uint32)atoi(argv[3]) : 64;
+	port = argc > 4 ? argv[4] : "27690";
+
+	if (messageSize == 0 || messageSize > ChunkSize)
+		messageSize = 64;
+
+	printf("%u round trips of %u bytes, %llu MB one way\n\n", roundTrips, messageSize, (unsigned long long)(bytes / 1048576));
+	printf("%-22s %13s %15s\n", "", "latency", "throughput");
+
+	/* what sidecars used before */
+	Run("loopback TCP", "127.0.0.1", port, SAL_Socket_Families_IPV4, SAL_Socket_Types_TCP);
+
+	Run("local stream", NULL, LocalName, SAL_Socket_Families_Local, SAL_Socket_Types_TCP);
+	Run("local seqpacket", NULL, LocalName, SAL_Socket_Families_Local, SAL_Socket_Types_SeqPacket);
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+/** vim: set noet ci pi sts=0 sw=4 ts=4
+ * @file Resolve.c
+ * @brief Measures name resolution through the resolver cache and the
+ * resolver threads against a stand-in resolver.
+ *
+ * Usage: Resolve [lookups] [names] [latency]. The stand-in answers every
+ * name ending in ".bench" with an address in 10.0.0.0/8 after sleeping
+ * latency milliseconds, so no network is needed. The lookups are spread
+ * over that many names, and each run starts with an empty cache.
+ */
+
+#include "../Socket.h"
+#include "../Thread.h"
+#include "../Time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32 latency;
+static uint32 queries;
+static SAL_Mutex queriesLock;
+static SAL_Semaphore answered;
+
+/* the stand-in for a real resolver */
+static uint32 StandIn(const int8* const host, uint8 family, SAL_Socket_Address* const addresses, uint32 maxAddresses, void* const state) {
+	uint32 number;
+	size_t length;
+
+	(void)state;
+
+	SAL_Mutex_Acquire(queriesLock);
+	queries++;
+	SAL_Mutex_Release(queriesLock);
+
+	SAL_Thread_Sleep(latency);
+
+	length = strlen(host);
+	if (length < 6 || strcmp(host + length - 6, ".bench") != 0 || family == SAL_Socket_Families_IPV6 || maxAddresses < 1)
+		return 0;
+
+	number = (uint32)atoi(host + 4);
+
+	memset(addresses, 0, sizeof(SAL_Socket_Address));
+	addresses[0].Family = SAL_Socket_Families_IPV4;
+	addresses[0].Address[0] = 10;
+	addresses[0].Address[1] = (uint8)(number >> 16);
+	addresses[0].Address[2] = (uint8)(number >> 8);
+	addresses[0].Address[3] = (uint8)number;
+
+	return 1;
+}
+
+static void Answered(const SAL_Socket_Address* const addresses, uint32 count, void* const state) {
+	(void)addresses;
+	(void)state;
+
+	if (count == 0)
+		printf("a lookup failed\n");
+
+	SAL_Semaphore_Increment(answered);
+}
+
+/* looks up @a lookups names, round robin over @a names of them, waiting on each answer before asking the next if @a serial. prints how long it took, how long the caller was held up issuing the lookups, how many reached the stand-in and how many joined a query already under way. */
+static void Run(const char* label, uint32 lookups, uint32 names, boolean serial) {
+	SAL_Socket_ResolverStats before;
+	SAL_Socket_ResolverStats after;
+	int8 host[32];
+	int64 started;
+	int64 issued;
+	int64 finished;
+	uint32 i;
+
+	SAL_Socket_FlushResolverCache();
+	SAL_Socket_GetResolverStats(&before);
+	queries = 0;
+
+	started = SAL_Time_Now();
+
+	for (i = 0; i < lookups; i++) {
+		sprintf(host, "host%u.bench", i % names);
+		SAL_Socket_ResolveAsync(host, "80", SAL_Socket_Families_IPAny, SAL_Socket_Types_TCP, Answered, NULL);
+
+		if (serial)
+			SAL_Semaphore_Decrement(answered);
+	}
+
+	issued = SAL_Time_Now();
+
+	if (!serial)
+		for (i = 0; i < lookups; i++)
+			SAL_Semaphore_Decrement(answered);
+
+	finished = SAL_Time_Now();
+
+	SAL_Socket_GetResolverStats(&after);
+
+	printf("%-22s %8lld ms %10lld ms %8u %10llu\n", label, (long long)(finished - started), (long long)(issued - started), queries, (unsigned long long)(after.Coalesced - before.Coalesced));
+}
+
+int main(int argc, char** argv) {
+	uint32 lookups;
+	uint32 names;
+	uint32 i;
+	int64 started;
+	int64 elapsed;
+
+	lookups = argc > 1 ? (uint32)atoi(argv[1]) : 400;
+	names = argc > 2 ? (uint32)atoi(argv[2]) : 50;
+	latency = argc > 3 ? (uint32)atoi(argv[3]) : 5;
+
+	queriesLock = SAL_Mutex_Create();
+	answered = SAL_Semaphore_Create();
+	SAL_Socket_SetResolver(StandIn, NULL);
+
+	printf("%u lookups of %u names, %ums per query\n\n", lookups, names, latency);
+	printf("%-22s %11s %13s %8s %10s\n", "", "total", "caller held", "queries", "coalesced");
+
+	/* what every connect paid before: a query per lookup, on the caller's thread */
+	SAL_Socket_SetResolverCache(0, 0);
+	Run("serial, uncached", lookups, names, true);
+	Run("concurrent, uncached", lookups, names, false);
+
+	SAL_Socket_SetResolverCache(60000, 5000);
+	Run("serial, cached", lookups, names, true);
+	Run("concurrent, cached", lookups, names, false);
+
+	/* and once every name is cached, which is answered before SAL_Socket_ResolveAsync returns */
+	started = SAL_Time_Now();
+
+	for (i = 0; i < lookups * 100; i++) {
+		SAL_Socket_ResolveAsync("host0.bench", "80", SAL_Socket_Families_IPAny, SAL_Socket_Types_TCP, Answered, NULL);
+		SAL_Semaphore_Decrement(answered);
+	}
+
+	elapsed = SAL_Time_Now() - started;
+
+	printf("\nwarm cache: %.0f ns per lookup\n", (double)elapsed * 1000000.0 / (lookups * 100));
+
+	SAL_Socket_SetResolver(NULL, NULL);
+
+	return 0;
+}
@@ -0,0 +1,152 @@
+/** vim: set noet ci pi sts=0 sw=4 ts=4
+ * @file Buffer.c
+ * @brief Pools of equally sized, reference counted buffers.
+ *
+ * A buffer can be handed from one thread to another: references may be taken
+ * and released from any thread, and the last release returns the buffer to
+ * its pool.
+ */
+
+#include "Buffer.h"
+
+#include <Utilities/Memory.h>
+
+#ifdef WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#endif
+
+/**
+ * Create a pool of buffers of @a size bytes.
+ *
+ * @param size The size of every buffer in the pool
+ * @param maxCached How many released buffers the pool keeps for reuse; the
+ * rest are freed
+ * @returns the pool
+ */
+SAL_Buffer_Pool* SAL_Buffer_Pool_Create(uint32 size, uint32 maxCached) {
+	SAL_Buffer_Pool* pool;
+
+	assert(size > 0);
+
+	pool = Allocate(SAL_Buffer_Pool);
+	pool->Lock = SAL_Mutex_Create();
+	pool->Free = NULL;
+	pool->Cached = 0;
+	pool->MaxCached = maxCached;
+	pool->Size = size;
+
+	return pool;
+}
+
+/**
+ * Free @a pool and the buffers it is keeping.
+ *
+ * @param pool The pool to free
+ *
+ * @warning Every buffer taken from the pool must have been released first.
+ */
+void SAL_Buffer_Pool_Free(SAL_Buffer_Pool* pool) {
+	SAL_Buffer* buffer;
+
+	assert(pool != NULL);
+
+	while ((buffer = pool->Free) != NULL) {
+		pool->Free = buffer->Next;
+		Free(buffer);
+	}
+
+	SAL_Mutex_Free(pool->Lock);
+	Free(pool);
+}
+
+/**
+ * Take a buffer from @a pool, allocating one if the pool has none spare.
+ *
+ * @param pool The pool to take from
+ * @returns a buffer of the pool's size holding one reference, which the
+ * caller releases with @ref SAL_Buffer_Release
+ */
+SAL_Buffer* SAL_Buffer_Get(SAL_Buffer_Pool* pool) {
+	SAL_Buffer* buffer;
+
+	assert(pool != NULL);
+
+	SAL_Mutex_Acquire(pool->Lock);
+
+	buffer = pool->Free;
+	if (buffer != NULL) {
+		pool->Free = buffer->Next;
+		pool->Cached--;
+	}
+
+	SAL_Mutex_Release(pool->Lock);
+
+	/* the data follows the header in the same allocation */
+	if (buffer == NULL) {
+		buffer = (SAL_Buffer*)AllocateArray(uint8, sizeof(SAL_Buffer) + pool->Size);
+		buffer->Data = (uint8*)(buffer + 1);
+		buffer->Size = pool->Size;
+		buffer->Pool = pool;
+	}
+
+	buffer->References = 1;
+	buffer->Next = NULL;
+
+	return buffer;
+}
+
+/**
+ * Take another reference to @a buffer, keeping it out of its pool until that
+ * reference is released too.
+ *
+ * @param buffer The buffer to keep
+ */
+void SAL_Buffer_Reference(SAL_Buffer* buffer) {
+	assert(buffer != NULL);
+	assert(buffer->References > 0);
+
+#ifdef WINDOWS
+	InterlockedIncrement((volatile LONG*)&buffer->References);
+#elif defined POSIX
+	__atomic_add_fetch(&buffer->References, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+/**
+ * Release a reference to @a buffer. The last release returns it to its pool.
+ *
+ * @param buffer The buffer to release
+ */
+void SAL_Buffer_Release(SAL_Buffer* buffer) {
+	SAL_Buffer_Pool* pool;
+	uint32 remaining;
+
+	assert(buffer != NULL);
+	assert(buffer->References > 0);
+
+#ifdef WINDOWS
+	remaining = (uint32)InterlockedDecrement((volatile LONG*)&buffer->References);
+#elif defined POSIX
+	remaining = __atomic_sub_fetch(&buffer->References, 1, __ATOMIC_ACQ_REL);
+#endif
+
+	if (remaining != 0)
+		return;
+
+	pool = buffer->Pool;
+
+	SAL_Mutex_Acquire(pool->Lock);
+
+	if (pool->Cached < pool->MaxCached) {
+		buffer->Next = pool->Free;
+		pool->Free = buffer;
+		pool->Cached++;
+		buffer = NULL;
+	}
+
+	SAL_Mutex_Release(pool->Lock);
+
+	if (buffer != NULL)
+		Free(buffer);
+}
@@ -0,0 +1,33 @@
+#ifndef INCLUDE_SAL_BUFFER
+#define INCLUDE_SAL_BUFFER
+
+#include "Common.h"
+#include "Thread.h"
+
+/* forward declaration */
+typedef struct SAL_Buffer_Pool SAL_Buffer_Pool;
+
+/* a reference counted buffer that goes back to its pool once the last reference is released */
+typedef struct SAL_Buffer {
+	uint8* Data;
+	uint32 Size;
+	uint32 References;
+	SAL_Buffer_Pool* Pool;
+	struct SAL_Buffer* Next; /* the next free buffer while it sits in the pool */
+} SAL_Buffer;
+
+struct SAL_Buffer_Pool {
+	SAL_Mutex Lock; /* guards Free and Cached */
+	SAL_Buffer* Free;
+	uint32 Cached;
+	uint32 MaxCached; /* buffers released beyond this many are freed instead of kept */
+	uint32 Size;
+};
+
+public SAL_Buffer_Pool* SAL_Buffer_Pool_Create(uint32 size, uint32 maxCached);
+public void SAL_Buffer_Pool_Free(SAL_Buffer_Pool* pool);
+public SAL_Buffer* SAL_Buffer_Get(SAL_Buffer_Pool* pool);
+public void SAL_Buffer_Reference(SAL_Buffer* buffer);
+public void SAL_Buffer_Release(SAL_Buffer* buffer);
+
+#endif
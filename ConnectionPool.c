@@ -0,0 +1,555 @@
+/** vim: set noet ci pi sts=0 sw=4 ts=4
+ * @file ConnectionPool.c
+ * @brief Pools of outbound connections, kept open between requests to the
+ * same endpoints.
+ *
+ * Each endpoint keeps its idle connections in shards, one per processor,
+ * each on a cache line of its own. A thread checks in to and out of the
+ * shard it was given, and only looks at the others when its own is empty,
+ * so threads working on the same endpoint rarely take the same lock.
+ */
+
+#include "ConnectionPool.h"
+#include "Thread.h"
+#include "Time.h"
+
+#include <Utilities/Memory.h>
+
+#include <string.h>
+
+#ifdef WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#endif
+
+#define SAL_ConnectionPool_CacheLine 64
+#define SAL_ConnectionPool_MaxShards 64
+#define SAL_ConnectionPool_Buckets 64
+
+/* an idle connection, and when it was checked in */
+typedef struct SAL_ConnectionPool_Idle {
+	SAL_Socket* Socket;
+	int64 Since;
+	struct SAL_ConnectionPool_Idle* Next;
+} SAL_ConnectionPool_Idle;
+
+typedef struct {
+	SAL_Mutex Lock;
+	SAL_ConnectionPool_Idle* Idle; /* most recently checked in first, so the oldest are at the end for eviction */
+	SAL_ConnectionPool_Idle* Spare; /* entries kept for the next check ins */
+	uint32 Count; /* read without the lock to skip empty shards */
+	uint8 Padding[SAL_ConnectionPool_CacheLine - sizeof(SAL_Mutex) - 2 * sizeof(void*) - sizeof(uint32)];
+} SAL_ConnectionPool_Shard;
+
+struct SAL_ConnectionPool_Endpoint {
+	SAL_ConnectionPool* Pool;
+	uint32 Hash;
+	int8* Host;
+	int8* Port;
+	uint8 Family;
+	uint8 Type;
+	uint32 MaxIdle;
+	uint32 MaxTotal;
+	uint32 Idle; /* connections in the shards */
+	uint32 Total; /* connections open, idle or checked out */
+	SAL_ConnectionPool_Shard* Shards;
+	uint8* ShardMemory; /* what Shards was aligned within */
+	struct SAL_ConnectionPool_Endpoint* Next;
+};
+
+struct SAL_ConnectionPool {
+	SAL_RWLock Lock; /* guards Endpoints; only taken for writing to add one */
+	SAL_ConnectionPool_Endpoint* Endpoints[SAL_ConnectionPool_Buckets];
+	uint32 MaxIdle; /* the limits new endpoints start with */
+	uint32 MaxTotal;
+	uint32 IdleTimeout;
+	uint32 ShardCount;
+	SAL_ConnectionPool_Stats Stats; /* counted atomically */
+};
+
+static uint32 poolThreads = 0;
+#ifdef WINDOWS
+	static __declspec(thread) uint32 poolThread = 0; /* numbers the threads that use a pool, from 1, to give each a shard */
+#elif defined POSIX
+	static __thread uint32 poolThread = 0;
+#endif
+
+static uint32 SAL_ConnectionPool_Add(uint32* value, int32 amount);
+static void SAL_ConnectionPool_Count(uint64* counter);
+static SAL_ConnectionPool_Shard* SAL_ConnectionPool_Home(SAL_ConnectionPool_Endpoint* endpoint);
+static void SAL_ConnectionPool_Discard(SAL_ConnectionPool_Endpoint* endpoint, SAL_Socket* socket, uint64* counter);
+static uint32 SAL_ConnectionPool_Hash(const int8* const address, const int8* port, uint8 family, uint8 type);
+
+/**
+ * Create a pool of connections.
+ *
+ * @param maxIdle How many idle connections each endpoint keeps; the rest are
+ * closed when they are checked in
+ * @param maxTotal How many connections each endpoint may have open, idle or
+ * checked out, at once
+ * @param idleTimeout Milliseconds an idle connection is kept; 0 keeps them
+ * until they fail a health check
+ * @returns the pool
+ */
+SAL_ConnectionPool* SAL_ConnectionPool_Create(uint32 maxIdle, uint32 maxTotal, uint32 idleTimeout) {
+	SAL_ConnectionPool* pool;
+
+	assert(maxTotal > 0);
+
+	pool = Allocate(SAL_ConnectionPool);
+	memset(pool, 0, sizeof(SAL_ConnectionPool));
+
+	pool->Lock = SAL_RWLock_Create();
+	pool->MaxIdle = maxIdle;
+	pool->MaxTotal = maxTotal;
+	pool->IdleTimeout = idleTimeout;
+	pool->ShardCount = SAL_Thread_GetProcessorCount();
+
+	if (pool->ShardCount == 0)
+		pool->ShardCount = 1;
+	else if (pool->ShardCount > SAL_ConnectionPool_MaxShards)
+		pool->ShardCount = SAL_ConnectionPool_MaxShards;
+
+	return pool;
+}
+
+/**
+ * Close the idle connections of @a pool and free it.
+ *
+ * @param pool The pool to free
+ *
+ * @warning Connections still checked out are not closed, and must not be
+ * checked in afterwards.
+ */
+void SAL_ConnectionPool_Free(SAL_ConnectionPool* pool) {
+	SAL_ConnectionPool_Endpoint* endpoint;
+	SAL_ConnectionPool_Shard* shard;
+	SAL_ConnectionPool_Idle* idle;
+	uint32 i;
+	uint32 j;
+
+	assert(pool != NULL);
+
+	for (i = 0; i < SAL_ConnectionPool_Buckets; i++) {
+		while ((endpoint = pool->Endpoints[i]) != NULL) {
+			pool->Endpoints[i] = endpoint->Next;
+
+			for (j = 0; j < pool->ShardCount; j++) {
+				shard = &endpoint->Shards[j];
+
+				while ((idle = shard->Idle) != NULL) {
+					shard->Idle = idle->Next;
+					SAL_Socket_Close(idle->Socket);
+					Free(idle);
+				}
+
+				while ((idle = shard->Spare) != NULL) {
+					shard->Spare = idle->Next;
+					Free(idle);
+				}
+
+				SAL_Mutex_Free(shard->Lock);
+			}
+
+			Free(endpoint->ShardMemory);
+			Free(endpoint->Host);
+			Free(endpoint->Port);
+			Free(endpoint);
+		}
+	}
+
+	SAL_RWLock_Free(pool->Lock);
+	Free(pool);
+}
+
+/**
+ * Get the endpoint of @a pool for a host and port, adding it if it is new.
+ * Look an endpoint up once and keep it, rather than on every checkout.
+ *
+ * @param pool The pool
+ * @param address A string specifying the hostname to connect to
+ * @param port Port to connect to
+ * @param family One of the SAL_Socket_Families_ values
+ * @param type One of the SAL_Socket_Types_ values
+ * @returns the endpoint, which lives as long as @a pool
+ */
+SAL_ConnectionPool_Endpoint* SAL_ConnectionPool_GetEndpoint(SAL_ConnectionPool* pool, const int8* const address, const int8* port, uint8 family, uint8 type) {
+	SAL_ConnectionPool_Endpoint* endpoint;
+	SAL_ConnectionPool_Endpoint* found;
+	uint8* memory;
+	size_t length;
+	uint32 hash;
+	uint32 i;
+
+	assert(pool != NULL);
+	assert(address != NULL);
+	assert(port != NULL);
+
+	hash = SAL_ConnectionPool_Hash(address, port, family, type);
+	found = NULL;
+
+	SAL_RWLock_AcquireRead(pool->Lock);
+
+	for (endpoint = pool->Endpoints[hash % SAL_ConnectionPool_Buckets]; endpoint != NULL && found == NULL; endpoint = endpoint->Next)
+		if (endpoint->Hash == hash && endpoint->Family == family && endpoint->Type == type && strcmp(endpoint->Host, address) == 0 && strcmp(endpoint->Port, port) == 0)
+			found = endpoint;
+
+	SAL_RWLock_ReleaseRead(pool->Lock);
+
+	if (found != NULL)
+		return found;
+
+	endpoint = Allocate(SAL_ConnectionPool_Endpoint);
+	endpoint->Pool = pool;
+	endpoint->Hash = hash;
+	endpoint->Family = family;
+	endpoint->Type = type;
+	endpoint->MaxIdle = pool->MaxIdle;
+	endpoint->MaxTotal = pool->MaxTotal;
+	endpoint->Idle = 0;
+	endpoint->Total = 0;
+
+	length = strlen(address) + 1;
+	endpoint->Host = AllocateArray(int8, length);
+	memcpy(endpoint->Host, address, length);
+
+	length = strlen(port) + 1;
+	endpoint->Port = AllocateArray(int8, length);
+	memcpy(endpoint->Port, port, length);
+
+	memory = AllocateArray(uint8, pool->ShardCount * sizeof(SAL_ConnectionPool_Shard) + SAL_ConnectionPool_CacheLine - 1);
+	endpoint->ShardMemory = memory;
+	endpoint->Shards = (SAL_ConnectionPool_Shard*)(memory + (SAL_ConnectionPool_CacheLine - (size_t)memory % SAL_ConnectionPool_CacheLine) % SAL_ConnectionPool_CacheLine);
+
+	for (i = 0; i < pool->ShardCount; i++) {
+		endpoint->Shards[i].Lock = SAL_Mutex_Create();
+		endpoint->Shards[i].Idle = NULL;
+		endpoint->Shards[i].Spare = NULL;
+		endpoint->Shards[i].Count = 0;
+	}
+
+	/* another thread may have added the endpoint meanwhile, in which case this one is thrown away */
+	SAL_RWLock_AcquireWrite(pool->Lock);
+
+	for (found = pool->Endpoints[hash % SAL_ConnectionPool_Buckets]; found != NULL; found = found->Next)
+		if (found->Hash == hash && found->Family == family && found->Type == type && strcmp(found->Host, address) == 0 && strcmp(found->Port, port) == 0)
+			break;
+
+	if (found == NULL) {
+		endpoint->Next = pool->Endpoints[hash % SAL_ConnectionPool_Buckets];
+		pool->Endpoints[hash % SAL_ConnectionPool_Buckets] = endpoint;
+	}
+
+	SAL_RWLock_ReleaseWrite(pool->Lock);
+
+	if (found == NULL)
+		return endpoint;
+
+	for (i = 0; i < pool->ShardCount; i++)
+		SAL_Mutex_Free(endpoint->Shards[i].Lock);
+
+	Free(endpoint->ShardMemory);
+	Free(endpoint->Host);
+	Free(endpoint->Port);
+	Free(endpoint);
+
+	return found;
+}
+
+/**
+ * Change the limits of @a endpoint from those its pool was created with.
+ *
+ * @param endpoint The endpoint
+ * @param maxIdle How many idle connections it keeps
+ * @param maxTotal How many connections it may have open at once
+ *
+ * @warning Connections beyond new, lower limits are only closed as they are
+ * checked in.
+ */
+void SAL_ConnectionPool_SetLimits(SAL_ConnectionPool_Endpoint* endpoint, uint32 maxIdle, uint32 maxTotal) {
+	assert(endpoint != NULL);
+	assert(maxTotal > 0);
+
+	endpoint->MaxIdle = maxIdle;
+	endpoint->MaxTotal = maxTotal;
+}
+
+/**
+ * Take a connection to @a endpoint: the most recently used idle one that is
+ * still healthy, or a new one. An idle connection is healthy if it has not
+ * been idle too long, and a non-blocking peek finds it open with nothing
+ * waiting to be read.
+ *
+ * @param endpoint The endpoint to connect to
+ * @returns a connected socket, to be given back with
+ * @ref SAL_ConnectionPool_Checkin, or NULL if the endpoint already has as
+ * many connections as it may or could not be connected to
+ *
+ * @warning Opening a new connection blocks until it is established.
+ */
+SAL_Socket* SAL_ConnectionPool_Checkout(SAL_ConnectionPool_Endpoint* endpoint) {
+	SAL_ConnectionPool* pool;
+	SAL_ConnectionPool_Shard* home;
+	SAL_ConnectionPool_Shard* shard;
+	SAL_ConnectionPool_Idle* idle;
+	SAL_Socket* socket;
+	int64 since;
+	int64 now;
+	uint32 i;
+
+	assert(endpoint != NULL);
+
+	pool = endpoint->Pool;
+	home = SAL_ConnectionPool_Home(endpoint);
+	now = pool->IdleTimeout != 0 ? SAL_Time_Now() : 0;
+
+	/* the thread's own shard first, then the others in turn */
+	for (i = 0; i < pool->ShardCount; i++) {
+		shard = &endpoint->Shards[((uint32)(home - endpoint->Shards) + i) % pool->ShardCount];
+
+		while (shard->Count != 0) {
+			SAL_Mutex_Acquire(shard->Lock);
+
+			idle = shard->Idle;
+			if (idle != NULL) {
+				shard->Idle = idle->Next;
+				shard->Count--;
+
+				socket = idle->Socket;
+				since = idle->Since;
+
+				idle->Next = shard->Spare;
+				shard->Spare = idle;
+			}
+
+			SAL_Mutex_Release(shard->Lock);
+
+			if (idle == NULL)
+				break;
+
+			SAL_ConnectionPool_Add(&endpoint->Idle, -1);
+
+			if (pool->IdleTimeout != 0 && now - since > (int64)pool->IdleTimeout)
+				SAL_ConnectionPool_Discard(endpoint, socket, &pool->Stats.Evicted);
+			else if (SAL_Socket_Peek(socket) != SAL_Socket_Status_WouldBlock)
+				SAL_ConnectionPool_Discard(endpoint, socket, &pool->Stats.Unhealthy);
+			else {
+				SAL_ConnectionPool_Count(&pool->Stats.Reused);
+				return socket;
+			}
+		}
+	}
+
+	if (SAL_ConnectionPool_Add(&endpoint->Total, 1) > endpoint->MaxTotal) {
+		SAL_ConnectionPool_Add(&endpoint->Total, -1);
+		SAL_ConnectionPool_Count(&pool->Stats.Exhausted);
+		return NULL;
+	}
+
+	socket = SAL_Socket_Connect(endpoint->Host, endpoint->Port, endpoint->Family, endpoint->Type);
+	if (socket == NULL) {
+		SAL_ConnectionPool_Add(&endpoint->Total, -1);
+		return NULL;
+	}
+
+	SAL_ConnectionPool_Count(&pool->Stats.Connected);
+
+	return socket;
+}
+
+/**
+ * Give back a connection taken with @a SAL_ConnectionPool_Checkout, to be
+ * kept for the next checkout or closed.
+ *
+ * @param endpoint The endpoint it was checked out of
+ * @param socket The connection
+ * @param reusable false if the connection must not be used again, such as
+ * after an error or a response that was not read to the end; it is closed
+ */
+void SAL_ConnectionPool_Checkin(SAL_ConnectionPool_Endpoint* endpoint, SAL_Socket* socket, boolean reusable) {
+	SAL_ConnectionPool_Shard* shard;
+	SAL_ConnectionPool_Idle* idle;
+
+	assert(endpoint != NULL);
+	assert(socket != NULL);
+
+	if (!reusable) {
+		SAL_ConnectionPool_Add(&endpoint->Total, -1);
+		SAL_Socket_Close(socket);
+		return;
+	}
+
+	if (SAL_ConnectionPool_Add(&endpoint->Idle, 1) > endpoint->MaxIdle) {
+		SAL_ConnectionPool_Add(&endpoint->Idle, -1);
+		SAL_ConnectionPool_Discard(endpoint, socket, &endpoint->Pool->Stats.Evicted);
+		return;
+	}
+
+	shard = SAL_ConnectionPool_Home(endpoint);
+
+	SAL_Mutex_Acquire(shard->Lock);
+
+	idle = shard->Spare;
+	if (idle != NULL)
+		shard->Spare = idle->Next;
+	else
+		idle = Allocate(SAL_ConnectionPool_Idle);
+
+	idle->Socket = socket;
+	idle->Since = endpoint->Pool->IdleTimeout != 0 ? SAL_Time_Now() : 0;
+	idle->Next = shard->Idle;
+
+	shard->Idle = idle;
+	shard->Count++;
+
+	SAL_Mutex_Release(shard->Lock);
+}
+
+/**
+ * Close the idle connections of @a pool that have been idle too long or
+ * fail a health check. Checkouts do this for the connections they come
+ * across; call this now and then so that connections that are not checked
+ * out are closed too.
+ *
+ * @param pool The pool
+ * @returns how many connections were closed
+ */
+uint32 SAL_ConnectionPool_Evict(SAL_ConnectionPool* pool) {
+	SAL_ConnectionPool_Endpoint* endpoint;
+	SAL_ConnectionPool_Shard* shard;
+	SAL_ConnectionPool_Idle* idle;
+	SAL_ConnectionPool_Idle** link;
+	uint64* reason;
+	uint32 closed;
+	uint32 i;
+	uint32 j;
+	int64 now;
+
+	assert(pool != NULL);
+
+	closed = 0;
+	now = SAL_Time_Now();
+
+	SAL_RWLock_AcquireRead(pool->Lock);
+
+	for (i = 0; i < SAL_ConnectionPool_Buckets; i++) {
+		for (endpoint = pool->Endpoints[i]; endpoint != NULL; endpoint = endpoint->Next) {
+			for (j = 0; j < pool->ShardCount; j++) {
+				shard = &endpoint->Shards[j];
+
+				if (shard->Count == 0)
+					continue;
+
+				SAL_Mutex_Acquire(shard->Lock);
+
+				link = &shard->Idle;
+				while ((idle = *link) != NULL) {
+					if (pool->IdleTimeout != 0 && now - idle->Since > (int64)pool->IdleTimeout)
+						reason = &pool->Stats.Evicted;
+					else if (SAL_Socket_Peek(idle->Socket) != SAL_Socket_Status_WouldBlock)
+						reason = &pool->Stats.Unhealthy;
+					else
+						reason = NULL;
+
+					if (reason == NULL) {
+						link = &idle->Next;
+						continue;
+					}
+
+					*link = idle->Next;
+					shard->Count--;
+					SAL_ConnectionPool_Add(&endpoint->Idle, -1);
+					SAL_ConnectionPool_Discard(endpoint, idle->Socket, reason);
+					closed++;
+
+					idle->Next = shard->Spare;
+					shard->Spare = idle;
+				}
+
+				SAL_Mutex_Release(shard->Lock);
+			}
+		}
+	}
+
+	SAL_RWLock_ReleaseRead(pool->Lock);
+
+	return closed;
+}
+
+/**
+ * Get the counts of @a pool.
+ *
+ * @param pool The pool
+ * @param stats Filled in with the counts
+ */
+void SAL_ConnectionPool_GetStats(SAL_ConnectionPool* pool, SAL_ConnectionPool_Stats* stats) {
+	assert(pool != NULL);
+	assert(stats != NULL);
+
+#ifdef WINDOWS
+	stats->Connected = (uint64)InterlockedCompareExchange64((volatile LONG64*)&pool->Stats.Connected, 0, 0);
+	stats->Reused = (uint64)InterlockedCompareExchange64((volatile LONG64*)&pool->Stats.Reused, 0, 0);
+	stats->Exhausted = (uint64)InterlockedCompareExchange64((volatile LONG64*)&pool->Stats.Exhausted, 0, 0);
+	stats->Unhealthy = (uint64)InterlockedCompareExchange64((volatile LONG64*)&pool->Stats.Unhealthy, 0, 0);
+	stats->Evicted = (uint64)InterlockedCompareExchange64((volatile LONG64*)&pool->Stats.Evicted, 0, 0);
+#elif defined POSIX
+	stats->Connected = __atomic_load_n(&pool->Stats.Connected, __ATOMIC_RELAXED);
+	stats->Reused = __atomic_load_n(&pool->Stats.Reused, __ATOMIC_RELAXED);
+	stats->Exhausted = __atomic_load_n(&pool->Stats.Exhausted, __ATOMIC_RELAXED);
+	stats->Unhealthy = __atomic_load_n(&pool->Stats.Unhealthy, __ATOMIC_RELAXED);
+	stats->Evicted = __atomic_load_n(&pool->Stats.Evicted, __ATOMIC_RELAXED);
+#endif
+}
+
+/* adds @a amount to @a value atomically and returns the result */
+static uint32 SAL_ConnectionPool_Add(uint32* value, int32 amount) {
+#ifdef WINDOWS
+	return (uint32)InterlockedExchangeAdd((volatile LONG*)value, amount) + (uint32)amount;
+#elif defined POSIX
+	return __atomic_add_fetch(value, (uint32)amount, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static void SAL_ConnectionPool_Count(uint64* counter) {
+#ifdef WINDOWS
+	InterlockedIncrement64((volatile LONG64*)counter);
+#elif defined POSIX
+	__atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+/* the shard of @a endpoint that the calling thread checks in to and out of first */
+static SAL_ConnectionPool_Shard* SAL_ConnectionPool_Home(SAL_ConnectionPool_Endpoint* endpoint) {
+	if (poolThread == 0)
+		poolThread = SAL_ConnectionPool_Add(&poolThreads, 1);
+
+	return &endpoint->Shards[(poolThread - 1) % endpoint->Pool->ShardCount];
+}
+
+/* closes a connection that will not be used again, counting it against @a counter */
+static void SAL_ConnectionPool_Discard(SAL_ConnectionPool_Endpoint* endpoint, SAL_Socket* socket, uint64* counter) {
+	SAL_ConnectionPool_Add(&endpoint->Total, -1);
+	SAL_ConnectionPool_Count(counter);
+	SAL_Socket_Close(socket);
+}
+
+/* FNV-1a over everything that tells endpoints apart */
+static uint32 SAL_ConnectionPool_Hash(const int8* const address, const int8* port, uint8 family, uint8 type) {
+	const int8* character;
+	uint32 hash;
+
+	hash = 2166136261U;
+
+	for (character = address; *character != '\0'; character++)
+		hash = (hash ^ (uint8)*character) * 16777619U;
+
+	hash = (hash ^ 0xFF) * 16777619U;
+
+	for (character = port; *character != '\0'; character++)
+		hash = (hash ^ (uint8)*character) * 16777619U;
+
+	hash = (hash ^ family) * 16777619U;
+	hash = (hash ^ type) * 16777619U;
+
+	return hash;
+}
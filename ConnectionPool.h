@@ -0,0 +1,28 @@
+#ifndef INCLUDE_SAL_CONNECTIONPOOL
+#define INCLUDE_SAL_CONNECTIONPOOL
+
+#include "Common.h"
+#include "Socket.h"
+
+/* opaque; connections are checked out of and in to an endpoint of the pool */
+typedef struct SAL_ConnectionPool SAL_ConnectionPool;
+typedef struct SAL_ConnectionPool_Endpoint SAL_ConnectionPool_Endpoint;
+
+typedef struct {
+	uint64 Connected; /* connections opened because none was idle */
+	uint64 Reused; /* checkouts given an idle connection */
+	uint64 Exhausted; /* checkouts refused because the endpoint had as many connections as it may */
+	uint64 Unhealthy; /* idle connections found closed by the peer, or with data waiting, and closed */
+	uint64 Evicted; /* idle connections closed for being idle too long, or for being more than the endpoint may keep */
+} SAL_ConnectionPool_Stats;
+
+public SAL_ConnectionPool* SAL_ConnectionPool_Create(uint32 maxIdle, uint32 maxTotal, uint32 idleTimeout);
+public void SAL_ConnectionPool_Free(SAL_ConnectionPool* pool);
+public SAL_ConnectionPool_Endpoint* SAL_ConnectionPool_GetEndpoint(SAL_ConnectionPool* pool, const int8* const address, const int8* port, uint8 family, uint8 type);
+public void SAL_ConnectionPool_SetLimits(SAL_ConnectionPool_Endpoint* endpoint, uint32 maxIdle, uint32 maxTotal);
+public SAL_Socket* SAL_ConnectionPool_Checkout(SAL_ConnectionPool_Endpoint* endpoint);
+public void SAL_ConnectionPool_Checkin(SAL_ConnectionPool_Endpoint* endpoint, SAL_Socket* socket, boolean reusable);
+public uint32 SAL_ConnectionPool_Evict(SAL_ConnectionPool* pool);
+public void SAL_ConnectionPool_GetStats(SAL_ConnectionPool* pool, SAL_ConnectionPool_Stats* stats);
+
+#endif
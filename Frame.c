@@ -0,0 +1,524 @@
+/** vim: set noet ci pi sts=0 sw=4 ts=4
+ * @file Frame.c
+ * @brief Reassembles messages that arrive split across, or packed into,
+ * reads.
+ *
+ * A reader owns one buffer. Data is read into the free space at its end and
+ * frames are handed out as slices of it, so a frame is never copied out. The
+ * only copy is of an incomplete frame, which is moved to the front of the
+ * buffer before the next read, so at most once per frame.
+ *
+ * Delimiters are searched for 16 or 32 bytes at a time with SSE2 or AVX2 on
+ * x86 processors that have them, picked when the first search runs.
+ */
+
+#include "Frame.h"
+
+#include <Utilities/Memory.h>
+#include <string.h>
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+	#include <immintrin.h>
+
+	#define SAL_Frame_X86
+	#define SAL_Frame_Target(instructions) __attribute__((target(instructions)))
+#elif defined _MSC_VER && (defined _M_X64 || defined _M_IX86)
+	#include <intrin.h>
+	#include <immintrin.h>
+
+	#define SAL_Frame_X86
+	#define SAL_Frame_Target(instructions)
+#endif
+
+/* room kept beyond the longest frame for its length prefix or delimiter */
+#define SAL_Frame_MaxHeader 8
+
+/* the smallest buffer a reader gets, so that a single read can take in many small frames */
+#define SAL_Frame_MinimumCapacity 16384
+
+typedef const uint8* (*SAL_Frame_Scanner)(const uint8* data, uint32 length, const uint8* const delimiter, uint8 delimiterLength);
+
+static const uint8* SAL_Frame_FindPortable(const uint8* data, uint32 length, const uint8* const delimiter, uint8 delimiterLength);
+#ifdef SAL_Frame_X86
+	static const uint8* SAL_Frame_CheckCandidates(const uint8* block, uint64 mask, const uint8* const delimiter, uint8 delimiterLength);
+	static uint8 SAL_Frame_DetectScanner(void);
+	static uint32 SAL_Frame_MatchSSE2(const uint8* block, __m128i first, __m128i last, uint32 offset);
+	static const uint8* SAL_Frame_FindSSE2(const uint8* data, uint32 length, const uint8* const delimiter, uint8 delimiterLength);
+	static uint32 SAL_Frame_MatchAVX2(const uint8* block, __m256i first, __m256i last, uint32 offset);
+	static const uint8* SAL_Frame_FindAVX2(const uint8* data, uint32 length, const uint8* const delimiter, uint8 delimiterLength);
+#endif
+
+/* chosen by the first search. Threads that race to choose it all store the same values. */
+static SAL_Frame_Scanner scanner = NULL;
+static uint8 scannerType = SAL_Frame_Scanners_Portable;
+
+/* returns the first occurrence of @a delimiter in the @a length bytes at @a data, or NULL */
+static const uint8* SAL_Frame_FindPortable(const uint8* data, uint32 length, const uint8* const delimiter, uint8 delimiterLength) {
+	const uint8* end;
+	const uint8* candidate;
+
+	if (length < delimiterLength)
+		return NULL;
+
+	end = data + length - delimiterLength + 1;
+
+	while (data < end) {
+		candidate = (const uint8*)memchr(data, delimiter[0], (size_t)(end - data));
+		if (candidate == NULL)
+			return NULL;
+
+		if (memcmp(candidate + 1, delimiter + 1, delimiterLength - 1) == 0)
+			return candidate;
+
+		data = candidate + 1;
+	}
+
+	return NULL;
+}
+
+#ifdef SAL_Frame_X86
+/* returns the first position in the 64 at @a block whose bit is set in @a mask that holds the whole delimiter. The bits mark positions where the first and the last byte of the delimiter already match. */
+static const uint8* SAL_Frame_CheckCandidates(const uint8* block, uint64 mask, const uint8* const delimiter, uint8 delimiterLength) {
+	uint32 bit;
+#ifdef _MSC_VER
+	unsigned long index;
+#endif
+
+	while (mask != 0) {
+		#ifdef _MSC_VER
+			if ((uint32)mask != 0)
+				_BitScanForward(&index, (uint32)mask);
+			else
+				_BitScanForward(&index, (uint32)(mask >> 32)), index += 32;
+			bit = (uint32)index;
+		#else
+			bit = (uint32)__builtin_ctzll(mask);
+		#endif
+
+		if (delimiterLength <= 2 || memcmp(block + bit + 1, delimiter + 1, delimiterLength - 2) == 0)
+			return block + bit;
+
+		mask &= mask - 1;
+	}
+
+	return NULL;
+}
+
+/* returns the widest scanner the processor, and the operating system, support */
+static uint8 SAL_Frame_DetectScanner(void) {
+#ifdef _MSC_VER
+	int registers[4];
+
+	__cpuid(registers, 0);
+	if (registers[0] < 7)
+		return SAL_Frame_Scanners_SSE2;
+
+	/* AVX2 also needs the operating system to save the upper halves of the registers, which OSXSAVE and XCR0 tell */
+	__cpuid(registers, 1);
+	if ((registers[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+		return (registers[3] & (1 << 26)) != 0 ? SAL_Frame_Scanners_SSE2 : SAL_Frame_Scanners_Portable;
+
+	__cpuid(registers, 7);
+
+	return (registers[1] & (1 << 5)) != 0 ? SAL_Frame_Scanners_AVX2 : SAL_Frame_Scanners_SSE2;
+#else
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return SAL_Frame_Scanners_AVX2;
+
+	if (__builtin_cpu_supports("sse2"))
+		return SAL_Frame_Scanners_SSE2;
+
+	return SAL_Frame_Scanners_Portable;
+#endif
+}
+
+/* returns a mask of the positions in the 16 at @a block where both the first and the last byte of the delimiter match */
+SAL_Frame_Target("sse2")
+static uint32 SAL_Frame_MatchSSE2(const uint8* block, __m128i first, __m128i last, uint32 offset) {
+	return (uint32)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)block)), _mm_cmpeq_epi8(last, _mm_loadu_si128((const __m128i*)(block + offset)))));
+}
+
+/* looks at 64 positions at a time, in four blocks of 16. Only the first byte of the delimiter is compared until one of them matches; then the last byte narrows the candidates down before the bytes in between are checked. The positions too close to the end for a whole block are left to the portable search. */
+SAL_Frame_Target("sse2")
+static const uint8* SAL_Frame_FindSSE2(const uint8* data, uint32 length, const uint8* const delimiter, uint8 delimiterLength) {
+	const uint8* found;
+	__m128i first;
+	__m128i last;
+	__m128i a;
+	__m128i b;
+	__m128i c;
+	__m128i d;
+	uint64 mask;
+	uint32 offset;
+	uint32 i;
+
+	first = _mm_set1_epi8((char)delimiter[0]);
+	last = _mm_set1_epi8((char)delimiter[delimiterLength - 1]);
+	offset = delimiterLength - 1;
+
+	for (i = 0; i + 64 + offset <= length; i += 64) {
+		a = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)(data + i)));
+		b = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)(data + i + 16)));
+		c = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)(data + i + 32)));
+		d = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)(data + i + 48)));
+
+		if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) == 0)
+			continue;
+
+		mask = SAL_Frame_MatchSSE2(data + i, first, last, offset);
+		mask |= (uint64)SAL_Frame_MatchSSE2(data + i + 16, first, last, offset) << 16;
+		mask |= (uint64)SAL_Frame_MatchSSE2(data + i + 32, first, last, offset) << 32;
+		mask |= (uint64)SAL_Frame_MatchSSE2(data + i + 48, first, last, offset) << 48;
+
+		found = SAL_Frame_CheckCandidates(data + i, mask, delimiter, delimiterLength);
+		if (found != NULL)
+			return found;
+	}
+
+	for (; i + 16 + offset <= length; i += 16) {
+		found = SAL_Frame_CheckCandidates(data + i, SAL_Frame_MatchSSE2(data + i, first, last, offset), delimiter, delimiterLength);
+		if (found != NULL)
+			return found;
+	}
+
+	return SAL_Frame_FindPortable(data + i, length - i, delimiter, delimiterLength);
+}
+
+/* the same as SAL_Frame_MatchSSE2, for 32 positions */
+SAL_Frame_Target("avx2")
+static uint32 SAL_Frame_MatchAVX2(const uint8* block, __m256i first, __m256i last, uint32 offset) {
+	return (uint32)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i*)block)), _mm256_cmpeq_epi8(last, _mm256_loadu_si256((const __m256i*)(block + offset)))));
+}
+
+/* the same as SAL_Frame_FindSSE2, 128 positions at a time in four blocks of 32 */
+SAL_Frame_Target("avx2")
+static const uint8* SAL_Frame_FindAVX2(const uint8* data, uint32 length, const uint8* const delimiter, uint8 delimiterLength) {
+	const uint8* found;
+	__m256i first;
+	__m256i last;
+	__m256i a;
+	__m256i b;
+	__m256i c;
+	__m256i d;
+	uint64 mask;
+	uint32 offset;
+	uint32 i;
+
+	first = _mm256_set1_epi8((char)delimiter[0]);
+	last = _mm256_set1_epi8((char)delimiter[delimiterLength - 1]);
+	offset = delimiterLength - 1;
+
+	for (i = 0; i + 128 + offset <= length; i += 128) {
+		a = _mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i*)(data + i)));
+		b = _mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i*)(data + i + 32)));
+		c = _mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i*)(data + i + 64)));
+		d = _mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i*)(data + i + 96)));
+
+		a = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+		if (_mm256_testz_si256(a, a))
+			continue;
+
+		mask = SAL_Frame_MatchAVX2(data + i, first, last, offset);
+		mask |= (uint64)SAL_Frame_MatchAVX2(data + i + 32, first, last, offset) << 32;
+
+		found = SAL_Frame_CheckCandidates(data + i, mask, delimiter, delimiterLength);
+		if (found != NULL)
+			return found;
+
+		mask = SAL_Frame_MatchAVX2(data + i + 64, first, last, offset);
+		mask |= (uint64)SAL_Frame_MatchAVX2(data + i + 96, first, last, offset) << 32;
+
+		found = SAL_Frame_CheckCandidates(data + i + 64, mask, delimiter, delimiterLength);
+		if (found != NULL)
+			return found;
+	}
+
+	for (; i + 32 + offset <= length; i += 32) {
+		found = SAL_Frame_CheckCandidates(data + i, SAL_Frame_MatchAVX2(data + i, first, last, offset), delimiter, delimiterLength);
+		if (found != NULL)
+			return found;
+	}
+
+	return SAL_Frame_FindPortable(data + i, length - i, delimiter, delimiterLength);
+}
+#endif
+
+/**
+ * Find the first occurrence of @a delimiter in the @a length bytes at
+ * @a data, with the scanner picked by @ref SAL_Frame_SetScanner, or the
+ * widest the processor supports.
+ *
+ * @param data Where to search
+ * @param length Number of bytes to search
+ * @param delimiter What to search for
+ * @param delimiterLength Length of @a delimiter
+ * @returns the start of the delimiter, or NULL if it wasn't found
+ */
+const uint8* SAL_Frame_Find(const uint8* const data, uint32 length, const uint8* const delimiter, uint8 delimiterLength) {
+	assert(data != NULL || length == 0);
+	assert(delimiter != NULL);
+	assert(delimiterLength > 0);
+
+	if (scanner == NULL)
+		SAL_Frame_SetScanner(SAL_Frame_Scanners_AVX2);
+
+	return scanner(data, length, delimiter, delimiterLength);
+}
+
+/**
+ * Pick how delimiters are searched for. Only needed to compare the scanners;
+ * by default the widest one the processor supports is used.
+ *
+ * @param type One of the SAL_Frame_Scanners_ values
+ * @returns the scanner that is used from now on: @a type, or the widest one
+ * narrower than it that the processor supports
+ */
+uint8 SAL_Frame_SetScanner(uint8 type) {
+#ifdef SAL_Frame_X86
+	uint8 supported;
+
+	supported = SAL_Frame_DetectScanner();
+	if (type > supported)
+		type = supported;
+
+	switch (type) {
+		case SAL_Frame_Scanners_AVX2:
+			scanner = SAL_Frame_FindAVX2;
+			break;
+
+		case SAL_Frame_Scanners_SSE2:
+			scanner = SAL_Frame_FindSSE2;
+			break;
+
+		default:
+			type = SAL_Frame_Scanners_Portable;
+			scanner = SAL_Frame_FindPortable;
+			break;
+	}
+#else
+	type = SAL_Frame_Scanners_Portable;
+	scanner = SAL_Frame_FindPortable;
+#endif
+
+	scannerType = type;
+
+	return type;
+}
+
+/**
+ * @returns the scanner delimiters are searched for with, one of the
+ * SAL_Frame_Scanners_ values
+ */
+uint8 SAL_Frame_GetScanner(void) {
+	if (scanner == NULL)
+		SAL_Frame_SetScanner(SAL_Frame_Scanners_AVX2);
+
+	return scannerType;
+}
+
+/**
+ * Set up @a reader to take frames of the given @a type out of the data read
+ * into it.
+ *
+ * @param reader The reader to initialize
+ * @param type One of the SAL_Frame_Types_ values
+ * @param delimiter For SAL_Frame_Types_Delimiter, the bytes that end each
+ * frame; ignored otherwise
+ * @param delimiterLength Length of @a delimiter, at most SAL_Frame_MaxDelimiter
+ * @param maxFrame The longest frame accepted, not counting its length prefix
+ * or delimiter
+ */
+void SAL_Frame_Reader_Initialize(SAL_Frame_Reader* reader, uint8 type, const uint8* const delimiter, uint8 delimiterLength, uint32 maxFrame) {
+	assert(reader != NULL);
+	assert(type <= SAL_Frame_Types_Delimiter);
+	assert(type != SAL_Frame_Types_Delimiter || (delimiter != NULL && delimiterLength > 0 && delimiterLength <= SAL_Frame_MaxDelimiter));
+	assert(maxFrame > 0);
+
+	reader->Capacity = maxFrame + SAL_Frame_MaxHeader;
+	if (reader->Capacity < SAL_Frame_MinimumCapacity)
+		reader->Capacity = SAL_Frame_MinimumCapacity;
+
+	reader->Buffer = AllocateArray(uint8, reader->Capacity);
+	reader->Start = 0;
+	reader->End = 0;
+	reader->Scanned = 0;
+	reader->MaxFrame = maxFrame;
+	reader->Type = type;
+	reader->DelimiterLength = 0;
+
+	if (type == SAL_Frame_Types_Delimiter) {
+		reader->DelimiterLength = delimiterLength;
+		memcpy(reader->Delimiter, delimiter, delimiterLength);
+	}
+}
+
+/**
+ * Free the buffer of @a reader, dropping anything still in it.
+ *
+ * @param reader The reader to destroy
+ */
+void SAL_Frame_Reader_Uninitialize(SAL_Frame_Reader* reader) {
+	assert(reader != NULL);
+
+	Free(reader->Buffer);
+	reader->Buffer = NULL;
+	reader->Capacity = 0;
+}
+
+/**
+ * Get the free space at the end of the buffer of @a reader to read into.
+ * Whatever is left of an incomplete frame is first moved to the front of the
+ * buffer, so this invalidates the frames handed out so far.
+ *
+ * @param reader The reader to read into
+ * @param available Set to the number of bytes that fit
+ * @returns where to put the data; pass how much was put there to
+ * @ref SAL_Frame_Reader_Commit
+ */
+uint8* SAL_Frame_Reader_GetSpace(SAL_Frame_Reader* reader, uint32* available) {
+	assert(reader != NULL);
+	assert(available != NULL);
+
+	if (reader->Start == reader->End) {
+		reader->Start = 0;
+		reader->End = 0;
+		reader->Scanned = 0;
+	}
+	else if (reader->Start > 0) {
+		memmove(reader->Buffer, reader->Buffer + reader->Start, reader->End - reader->Start);
+		reader->End -= reader->Start;
+		reader->Scanned -= reader->Start;
+		reader->Start = 0;
+	}
+
+	*available = reader->Capacity - reader->End;
+
+	return reader->Buffer + reader->End;
+}
+
+/**
+ * Add @a length bytes, just read into the space returned by
+ * @ref SAL_Frame_Reader_GetSpace, to @a reader.
+ *
+ * @param reader The reader that was read into
+ * @param length Number of bytes read
+ */
+void SAL_Frame_Reader_Commit(SAL_Frame_Reader* reader, uint32 length) {
+	assert(reader != NULL);
+	assert(length <= reader->Capacity - reader->End);
+
+	reader->End += length;
+}
+
+/**
+ * Take the next complete frame out of @a reader.
+ *
+ * @param reader The reader to take the frame from
+ * @param frame Set to the start of the frame, past its length prefix
+ * @param length Set to the length of the frame, without its length prefix or
+ * delimiter
+ * @returns SAL_Frame_Result_Frame if a frame was taken,
+ * SAL_Frame_Result_Incomplete if more data is needed first, or
+ * SAL_Frame_Result_TooLong or SAL_Frame_Result_Malformed if the data can't
+ * be framed, after which the reader is of no further use.
+ *
+ * @warning @a frame points into the buffer of @a reader and stays valid until
+ * the next call to @ref SAL_Frame_Reader_GetSpace.
+ */
+int8 SAL_Frame_Reader_Next(SAL_Frame_Reader* reader, const uint8** frame, uint32* length) {
+	const uint8* data;
+	const uint8* found;
+	uint32 available;
+	uint32 header;
+	uint32 size;
+
+	assert(reader != NULL);
+	assert(frame != NULL);
+	assert(length != NULL);
+
+	data = reader->Buffer + reader->Start;
+	available = reader->End - reader->Start;
+
+	switch (reader->Type) {
+		case SAL_Frame_Types_U16:
+			if (available < 2)
+				return SAL_Frame_Result_Incomplete;
+
+			header = 2;
+			size = ((uint32)data[0] << 8) | data[1];
+			break;
+
+		case SAL_Frame_Types_U32:
+			if (available < 4)
+				return SAL_Frame_Result_Incomplete;
+
+			header = 4;
+			size = ((uint32)data[0] << 24) | ((uint32)data[1] << 16) | ((uint32)data[2] << 8) | data[3];
+			break;
+
+		case SAL_Frame_Types_Varint:
+			size = 0;
+
+			for (header = 0; ; header++) {
+				if (header == available)
+					return SAL_Frame_Result_Incomplete;
+
+				/* a 32 bit length takes at most five bytes, and only four bits of the fifth */
+				if (header == 4 && data[header] > 0x0F)
+					return SAL_Frame_Result_Malformed;
+
+				size |= (uint32)(data[header] & 0x7F) << (7 * header);
+
+				if ((data[header] & 0x80) == 0)
+					break;
+			}
+
+			header++;
+			break;
+
+		case SAL_Frame_Types_Delimiter:
+			/* only the bytes that arrived since the last look are searched, along with the end of those before that could start a delimiter */
+			found = SAL_Frame_Find(reader->Buffer + reader->Scanned, reader->End - reader->Scanned, reader->Delimiter, reader->DelimiterLength);
+
+			if (found == NULL) {
+				if (available >= reader->MaxFrame + reader->DelimiterLength)
+					return SAL_Frame_Result_TooLong;
+
+				if (reader->End - reader->Scanned >= reader->DelimiterLength)
+					reader->Scanned = reader->End - reader->DelimiterLength + 1;
+
+				return SAL_Frame_Result_Incomplete;
+			}
+
+			size = (uint32)(found - data);
+			if (size > reader->MaxFrame)
+				return SAL_Frame_Result_TooLong;
+
+			*frame = data;
+			*length = size;
+
+			reader->Start += size + reader->DelimiterLength;
+			reader->Scanned = reader->Start;
+
+			return SAL_Frame_Result_Frame;
+
+		default:
+			return SAL_Frame_Result_Malformed;
+	}
+
+	if (size > reader->MaxFrame)
+		return SAL_Frame_Result_TooLong;
+
+	if (available - header < size)
+		return SAL_Frame_Result_Incomplete;
+
+	*frame = data + header;
+	*length = size;
+
+	reader->Start += header + size;
+	reader->Scanned = reader->Start;
+
+	return SAL_Frame_Result_Frame;
+}
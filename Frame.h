@@ -0,0 +1,44 @@
+#ifndef INCLUDE_SAL_FRAME
+#define INCLUDE_SAL_FRAME
+
+#include "Common.h"
+
+#define SAL_Frame_Types_U16 0 /* a big endian 16 bit length, then the frame */
+#define SAL_Frame_Types_U32 1 /* a big endian 32 bit length, then the frame */
+#define SAL_Frame_Types_Varint 2 /* a base 128 length, low bits first, then the frame */
+#define SAL_Frame_Types_Delimiter 3 /* the frame, then a delimiter */
+
+#define SAL_Frame_MaxDelimiter 8
+
+#define SAL_Frame_Result_Frame 1
+#define SAL_Frame_Result_Incomplete 0
+#define SAL_Frame_Result_TooLong -1
+#define SAL_Frame_Result_Malformed -2
+
+#define SAL_Frame_Scanners_Portable 0 /* memchr and memcmp */
+#define SAL_Frame_Scanners_SSE2 1 /* 16 bytes at a time */
+#define SAL_Frame_Scanners_AVX2 2 /* 32 bytes at a time */
+
+/* a buffer that data is read into and complete frames are taken out of in place */
+typedef struct {
+	uint8* Buffer;
+	uint32 Capacity;
+	uint32 Start; /* the first byte not yet taken by a frame */
+	uint32 End; /* the first free byte */
+	uint32 Scanned; /* where to carry on looking for a delimiter */
+	uint32 MaxFrame;
+	uint8 Type;
+	uint8 DelimiterLength;
+	uint8 Delimiter[SAL_Frame_MaxDelimiter];
+} SAL_Frame_Reader;
+
+public void SAL_Frame_Reader_Initialize(SAL_Frame_Reader* reader, uint8 type, const uint8* const delimiter, uint8 delimiterLength, uint32 maxFrame);
+public void SAL_Frame_Reader_Uninitialize(SAL_Frame_Reader* reader);
+public uint8* SAL_Frame_Reader_GetSpace(SAL_Frame_Reader* reader, uint32* available);
+public void SAL_Frame_Reader_Commit(SAL_Frame_Reader* reader, uint32 length);
+public int8 SAL_Frame_Reader_Next(SAL_Frame_Reader* reader, const uint8** frame, uint32* length);
+public const uint8* SAL_Frame_Find(const uint8* const data, uint32 length, const uint8* const delimiter, uint8 delimiterLength);
+public uint8 SAL_Frame_SetScanner(uint8 type);
+public uint8 SAL_Frame_GetScanner(void);
+
+#endif
@@ -0,0 +1,327 @@
+/** vim: set noet ci pi sts=0 sw=4 ts=4
+ * @file Ring.c
+ * @brief A thin wrapper over the Linux io_uring submission and completion
+ * queues.
+ *
+ * Only the ring plumbing lives here; what is submitted is up to the caller.
+ * A ring is not thread safe: calls that touch the submission queue must be
+ * serialized, and only one thread may consume completions.
+ *
+ * @warning Only available under POSIX, and requires Linux 5.1 or newer.
+ * Provided buffer rings need Linux 5.19. Which operations and flags work
+ * depends on the kernel, well past 5.1 for the socket engine, so callers
+ * should try what they rely on before they use the ring.
+ * @ref SAL_Ring_Initialize fails cleanly on kernels (or sandboxes) without
+ * io_uring so callers can fall back to something else.
+ */
+
+#include "Ring.h"
+
+#ifdef POSIX
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Create a ring with room for @a entries submissions.
+ *
+ * @param ring The ring to initialize
+ * @param entries Number of submission queue entries, rounded up to a power of
+ * two by the kernel
+ * @returns true if the ring was created, false if io_uring is unavailable
+ */
+boolean SAL_Ring_Initialize(SAL_Ring* ring, uint32 entries) {
+	struct io_uring_params parameters;
+	uint8* submissionRing;
+	uint8* completionRing;
+
+	assert(ring != NULL);
+
+	memset(ring, 0, sizeof(SAL_Ring));
+	memset(&parameters, 0, sizeof(parameters));
+
+	ring->Descriptor = (int)syscall(__NR_io_uring_setup, entries, &parameters);
+	if (ring->Descriptor < 0)
+		return false;
+
+	ring->Features = parameters.features;
+	ring->SubmissionRingSize = parameters.sq_off.array + parameters.sq_entries * sizeof(uint32);
+	ring->CompletionRingSize = parameters.cq_off.cqes + parameters.cq_entries * sizeof(struct io_uring_cqe);
+	ring->SubmissionsSize = parameters.sq_entries * sizeof(struct io_uring_sqe);
+
+	/* newer kernels map both rings with a single mmap */
+	if (ring->Features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->CompletionRingSize > ring->SubmissionRingSize)
+			ring->SubmissionRingSize = ring->CompletionRingSize;
+		ring->CompletionRingSize = ring->SubmissionRingSize;
+	}
+
+	ring->SubmissionRing = mmap(NULL, ring->SubmissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->Descriptor, IORING_OFF_SQ_RING);
+	if (ring->SubmissionRing == MAP_FAILED)
+		goto error;
+
+	if (ring->Features & IORING_FEAT_SINGLE_MMAP) {
+		ring->CompletionRing = ring->SubmissionRing;
+	}
+	else {
+		ring->CompletionRing = mmap(NULL, ring->CompletionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->Descriptor, IORING_OFF_CQ_RING);
+		if (ring->CompletionRing == MAP_FAILED)
+			goto error;
+	}
+
+	ring->Submissions = (struct io_uring_sqe*)mmap(NULL, ring->SubmissionsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->Descriptor, IORING_OFF_SQES);
+	if (ring->Submissions == MAP_FAILED)
+		goto error;
+
+	submissionRing = (uint8*)ring->SubmissionRing;
+	completionRing = (uint8*)ring->CompletionRing;
+
+	ring->SubmissionHead = (uint32*)(submissionRing + parameters.sq_off.head);
+	ring->SubmissionTail = (uint32*)(submissionRing + parameters.sq_off.tail);
+	ring->SubmissionArray = (uint32*)(submissionRing + parameters.sq_off.array);
+	ring->SubmissionFlags = (uint32*)(submissionRing + parameters.sq_off.flags);
+	ring->SubmissionMask = *(uint32*)(submissionRing + parameters.sq_off.ring_mask);
+	ring->SubmissionEntries = *(uint32*)(submissionRing + parameters.sq_off.ring_entries);
+
+	ring->CompletionHead = (uint32*)(completionRing + parameters.cq_off.head);
+	ring->CompletionTail = (uint32*)(completionRing + parameters.cq_off.tail);
+	ring->CompletionMask = *(uint32*)(completionRing + parameters.cq_off.ring_mask);
+	ring->Completions = (struct io_uring_cqe*)(completionRing + parameters.cq_off.cqes);
+
+	return true;
+
+error:
+	SAL_Ring_Uninitialize(ring);
+
+	return false;
+}
+
+/**
+ * Unmap and close @a ring. Operations still in flight are cancelled by the
+ * kernel.
+ *
+ * @param ring The ring to destroy
+ */
+void SAL_Ring_Uninitialize(SAL_Ring* ring) {
+	assert(ring != NULL);
+
+	if (ring->Submissions != NULL && ring->Submissions != MAP_FAILED)
+		munmap(ring->Submissions, ring->SubmissionsSize);
+
+	if (ring->CompletionRing != NULL && ring->CompletionRing != MAP_FAILED && ring->CompletionRing != ring->SubmissionRing)
+		munmap(ring->CompletionRing, ring->CompletionRingSize);
+
+	if (ring->SubmissionRing != NULL && ring->SubmissionRing != MAP_FAILED)
+		munmap(ring->SubmissionRing, ring->SubmissionRingSize);
+
+	if (ring->Descriptor >= 0)
+		close(ring->Descriptor);
+
+	memset(ring, 0, sizeof(SAL_Ring));
+	ring->Descriptor = -1;
+}
+
+/**
+ * Reserve the next submission queue entry. The entry is zeroed; fill it in
+ * and it is sent to the kernel by the next @ref SAL_Ring_Submit.
+ *
+ * @param ring The ring to submit to
+ * @returns the entry, or NULL if the submission queue is full
+ */
+struct io_uring_sqe* SAL_Ring_GetSubmission(SAL_Ring* ring) {
+	struct io_uring_sqe* submission;
+	uint32 tail;
+
+	assert(ring != NULL);
+
+	tail = *ring->SubmissionTail + ring->SubmissionQueued;
+	if (tail - __atomic_load_n(ring->SubmissionHead, __ATOMIC_ACQUIRE) >= ring->SubmissionEntries)
+		return NULL;
+
+	submission = &ring->Submissions[tail & ring->SubmissionMask];
+	ring->SubmissionArray[tail & ring->SubmissionMask] = tail & ring->SubmissionMask;
+	ring->SubmissionQueued++;
+
+	memset(submission, 0, sizeof(struct io_uring_sqe));
+
+	return submission;
+}
+
+/**
+ * Pass every entry reserved since the last call to the kernel in one system
+ * call. This also moves completions that overflowed the completion queue
+ * back into it, so it is worth calling even with nothing queued.
+ *
+ * @param ring The ring to submit
+ * @param waitFor Number of completions to wait for before returning
+ * @returns the number of entries consumed by the kernel, or a negated errno.
+ * Entries the kernel did not consume, because it was short of memory or its
+ * completion queue was full, stay queued and are passed again by the next
+ * call.
+ */
+int32 SAL_Ring_Submit(SAL_Ring* ring, uint32 waitFor) {
+	uint32 tail;
+	uint32 pending;
+	boolean overflowed;
+	int32 result;
+
+	assert(ring != NULL);
+
+	tail = *ring->SubmissionTail + ring->SubmissionQueued;
+	pending = tail - __atomic_load_n(ring->SubmissionHead, __ATOMIC_ACQUIRE);
+	overflowed = (__atomic_load_n(ring->SubmissionFlags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW) != 0;
+	if (pending == 0 && waitFor == 0 && !overflowed)
+		return 0;
+
+	__atomic_store_n(ring->SubmissionTail, tail, __ATOMIC_RELEASE);
+	ring->SubmissionQueued = 0;
+
+	/* the kernel takes entries from its head, so what it left behind last time goes ahead of the new ones */
+	do {
+		result = (int32)syscall(__NR_io_uring_enter, ring->Descriptor, pending, waitFor, (waitFor > 0 || overflowed) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	} while (result < 0 && errno == EINTR);
+
+	return result < 0 ? -errno : result;
+}
+
+/**
+ * @returns the oldest unconsumed completion, or NULL if there is none.
+ * Release it with @ref SAL_Ring_AdvanceCompletions once it has been read.
+ */
+struct io_uring_cqe* SAL_Ring_PeekCompletion(SAL_Ring* ring) {
+	uint32 head;
+
+	assert(ring != NULL);
+
+	head = *ring->CompletionHead;
+	if (head == __atomic_load_n(ring->CompletionTail, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	return &ring->Completions[head & ring->CompletionMask];
+}
+
+/**
+ * Hand @a count consumed completions back to the kernel.
+ */
+void SAL_Ring_AdvanceCompletions(SAL_Ring* ring, uint32 count) {
+	assert(ring != NULL);
+
+	__atomic_store_n(ring->CompletionHead, *ring->CompletionHead + count, __ATOMIC_RELEASE);
+}
+
+/**
+ * Give the kernel @a count buffers of @a size bytes to pick from for reads
+ * that select a buffer from @a group. Which buffer was used is reported in the
+ * completion flags (IORING_CQE_F_BUFFER), and the buffer belongs to the caller
+ * until it is handed back with @ref SAL_Ring_ReturnBuffer.
+ *
+ * @param ring The ring to register the buffers with
+ * @param buffers The group to initialize
+ * @param group Buffer group id to register under
+ * @param count Number of buffers; must be a power of two no larger than 32768
+ * @param size Size of each buffer
+ * @returns true if the buffers were registered, false if the kernel does not
+ * support provided buffer rings
+ */
+boolean SAL_Ring_RegisterBuffers(SAL_Ring* ring, SAL_Ring_Buffers* buffers, uint16 group, uint32 count, uint32 size) {
+	struct io_uring_buf_reg registration;
+	uint32 i;
+
+	assert(ring != NULL);
+	assert(buffers != NULL);
+	assert(count > 0 && count <= 32768 && (count & (count - 1)) == 0);
+
+	buffers->Count = count;
+	buffers->Size = size;
+	buffers->Group = group;
+	buffers->Tail = 0;
+
+	/* the ring has to be page aligned, which mmap guarantees */
+	buffers->Ring = (struct io_uring_buf_ring*)mmap(NULL, count * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	buffers->Memory = (uint8*)mmap(NULL, (uint64)count * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (buffers->Ring == MAP_FAILED || buffers->Memory == MAP_FAILED)
+		goto error;
+
+	memset(&registration, 0, sizeof(registration));
+	registration.ring_addr = (uint64)(size_t)buffers->Ring;
+	registration.ring_entries = count;
+	registration.bgid = group;
+
+	if (syscall(__NR_io_uring_register, ring->Descriptor, IORING_REGISTER_PBUF_RING, &registration, 1) < 0)
+		goto error;
+
+	for (i = 0; i < count; i++)
+		SAL_Ring_ReturnBuffer(buffers, (uint16)i);
+
+	return true;
+
+error:
+	if (buffers->Ring != MAP_FAILED)
+		munmap(buffers->Ring, count * sizeof(struct io_uring_buf));
+	if (buffers->Memory != MAP_FAILED)
+		munmap(buffers->Memory, (uint64)count * size);
+
+	buffers->Ring = NULL;
+	buffers->Memory = NULL;
+
+	return false;
+}
+
+/**
+ * Take @a buffers back from the kernel and free them.
+ */
+void SAL_Ring_UnregisterBuffers(SAL_Ring* ring, SAL_Ring_Buffers* buffers) {
+	struct io_uring_buf_reg registration;
+
+	assert(ring != NULL);
+	assert(buffers != NULL);
+
+	if (buffers->Ring == NULL)
+		return;
+
+	memset(&registration, 0, sizeof(registration));
+	registration.bgid = buffers->Group;
+	syscall(__NR_io_uring_register, ring->Descriptor, IORING_UNREGISTER_PBUF_RING, &registration, 1);
+
+	munmap(buffers->Ring, buffers->Count * sizeof(struct io_uring_buf));
+	munmap(buffers->Memory, (uint64)buffers->Count * buffers->Size);
+
+	buffers->Ring = NULL;
+	buffers->Memory = NULL;
+}
+
+/**
+ * @returns the memory of buffer @a id, as reported by a completion
+ */
+uint8* SAL_Ring_GetBuffer(SAL_Ring_Buffers* buffers, uint16 id) {
+	assert(buffers != NULL);
+	assert(id < buffers->Count);
+
+	return buffers->Memory + (uint64)id * buffers->Size;
+}
+
+/**
+ * Hand buffer @a id back to the kernel so it can be picked again.
+ *
+ * @warning Like the submission queue, returning buffers must be serialized.
+ */
+void SAL_Ring_ReturnBuffer(SAL_Ring_Buffers* buffers, uint16 id) {
+	struct io_uring_buf* buffer;
+
+	assert(buffers != NULL);
+	assert(id < buffers->Count);
+
+	buffer = &buffers->Ring->bufs[buffers->Tail & (buffers->Count - 1)];
+	buffer->addr = (uint64)(size_t)SAL_Ring_GetBuffer(buffers, id);
+	buffer->len = buffers->Size;
+	buffer->bid = id;
+
+	buffers->Tail++;
+	__atomic_store_n(&buffers->Ring->tail, buffers->Tail, __ATOMIC_RELEASE);
+}
+
+#endif
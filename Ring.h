@@ -0,0 +1,56 @@
+#ifndef INCLUDE_SAL_RING
+#define INCLUDE_SAL_RING
+
+#include "Common.h"
+
+#ifdef POSIX
+	#include <linux/io_uring.h>
+
+	typedef struct {
+		int Descriptor;
+		uint32 Features;
+
+		uint32* SubmissionHead;
+		uint32* SubmissionTail;
+		uint32* SubmissionArray;
+		uint32* SubmissionFlags;
+		uint32 SubmissionMask;
+		uint32 SubmissionEntries;
+		uint32 SubmissionQueued; /* entries handed out by SAL_Ring_GetSubmission but not yet passed to the kernel */
+		struct io_uring_sqe* Submissions;
+
+		uint32* CompletionHead;
+		uint32* CompletionTail;
+		uint32 CompletionMask;
+		struct io_uring_cqe* Completions;
+
+		void* SubmissionRing;
+		uint64 SubmissionRingSize;
+		void* CompletionRing;
+		uint64 CompletionRingSize;
+		uint64 SubmissionsSize;
+	} SAL_Ring;
+
+	/* a group of equally sized buffers the kernel picks from for reads submitted with IOSQE_BUFFER_SELECT */
+	typedef struct {
+		struct io_uring_buf_ring* Ring;
+		uint8* Memory;
+		uint32 Count;
+		uint32 Size;
+		uint16 Group;
+		uint16 Tail;
+	} SAL_Ring_Buffers;
+
+	public boolean SAL_Ring_Initialize(SAL_Ring* ring, uint32 entries);
+	public void SAL_Ring_Uninitialize(SAL_Ring* ring);
+	public struct io_uring_sqe* SAL_Ring_GetSubmission(SAL_Ring* ring);
+	public int32 SAL_Ring_Submit(SAL_Ring* ring, uint32 waitFor);
+	public struct io_uring_cqe* SAL_Ring_PeekCompletion(SAL_Ring* ring);
+	public void SAL_Ring_AdvanceCompletions(SAL_Ring* ring, uint32 count);
+	public boolean SAL_Ring_RegisterBuffers(SAL_Ring* ring, SAL_Ring_Buffers* buffers, uint16 group, uint32 count, uint32 size);
+	public void SAL_Ring_UnregisterBuffers(SAL_Ring* ring, SAL_Ring_Buffers* buffers);
+	public uint8* SAL_Ring_GetBuffer(SAL_Ring_Buffers* buffers, uint16 id);
+	public void SAL_Ring_ReturnBuffer(SAL_Ring_Buffers* buffers, uint16 id);
+#endif
+
+#endif
@@ -3,13 +3,21 @@
  * @brief TCP networking functions
  *
  * @warning Under windows, only IPv4 is implemented.
- * Under POSIX, IPv4 and IPv6 are supported.
+ * Under POSIX, IPv4 and IPv6 are supported. The POSIX reactors are built on
+ * epoll and so require Linux; the optional io_uring engine needs Linux 5.19
+ * or newer, for multishot accepts and cancelling by descriptor, and falls
+ * back to epoll when the kernel refuses it. Multishot receives also need
+ * Linux 6.0 and are otherwise carried out on readiness.
  */
+#define _GNU_SOURCE /* accept4 */
+
 #include "Socket.h"
 
 #include <Utilities/AsyncLinkedList.h>
 #include <Utilities/Memory.h>
+#include "Ring.h"
 #include "Thread.h"
+#include "Time.h"
 
 #ifdef WINDOWS
 	#define WIN32_LEAN_AND_MEAN
@@ -17,443 +25,5732 @@
 	#include <Windows.h>
 	#include <winsock2.h>
 	#include <ws2tcpip.h>
+	#include <mswsock.h>
+	#include <afunix.h>
 
 	static boolean winsockInitialized = false;
 #elif defined POSIX
+	#include <linux/errqueue.h>
+	#include <linux/filter.h>
+	#include <sys/epoll.h>
+	#include <sys/eventfd.h>
 	#include <sys/select.h>
+	#include <sys/sendfile.h>
 	#include <sys/socket.h>
+	#include <sys/stat.h>
 	#include <sys/types.h>
+	#include <sys/un.h>
+	#include <errno.h>
+	#include <fcntl.h>
 	#include <netinet/in.h>
 	#include <arpa/inet.h>
 	#include <netdb.h>
+	#include <poll.h>
+	#include <stddef.h>
 	#include <stdio.h>
 	#include <string.h>
+	#include <unistd.h>
+
+	#define SAL_Socket_Reactor_MaxEvents 256
+	#define SAL_Socket_RingEntries 256
+	#define SAL_Socket_RingBufferGroup 0
+	#define SAL_Socket_RingBufferCount 1024 /* shared out between the reactors */
+	#define SAL_Socket_RingBufferMinimum 64
 #endif
 
-static void SAL_Socket_Initialize(SAL_Socket* socket);
-static SAL_Socket* SAL_Socket_PrepareRawSocket(const int8* const address, const int8* port, uint8 family, uint8 type, boolean willListenOn, struct addrinfo** addressInfo);
-static void SAL_Socket_CallbackWorker_Initialize();
-static void SAL_Socket_CallbackWorker_Shutdown();
-static SAL_Thread_Start(SAL_Socket_CallbackWorker_Run);
+#define SAL_Socket_Interest_Read 1
+#define SAL_Socket_Interest_Write 2
+#define SAL_Socket_Interest_Errors 4 /* only the error queue, which epoll always reports */
 
-static AsyncLinkedList asyncSocketList;
-static SAL_Thread asyncWorker;
-static boolean asyncWorkerRunning = false;
+#define SAL_Socket_Operations_Read 0
+#define SAL_Socket_Operations_Write 1
+#define SAL_Socket_Operations_Accept 2
+#define SAL_Socket_Operations_Connect 3
+#define SAL_Socket_Operations_AcceptMultishot 4
+#define SAL_Socket_Operations_ReceiveMultishot 5
+#define SAL_Socket_Operations_SendFile 6
+#define SAL_Socket_Operations_Relay 7
+#define SAL_Socket_Operations_Flush 8
+#define SAL_Socket_Operations_ReceiveFrames 9
 
-static SAL_Thread_Start(SAL_Socket_CallbackWorker_Run) {
-#ifdef WINDOWS
-	fd_set readSet;
-	uint32 i;
-	SAL_Socket* asyncSocket;
-	AsyncLinkedList_Iterator selectIterator;
-	struct timeval selectTimeout;
+/* how long a connection attempt gets before the next address is tried alongside it, as RFC 8305 recommends */
+#define SAL_Socket_ConnectionAttemptDelay 250
 
-	AsyncLinkedList_InitializeIterator(&selectIterator, &asyncSocketList);
-	selectTimeout.tv_usec = 250;
-	selectTimeout.tv_sec = 0;
+/* the most a file transfer sends in one call, so that a large file doesn't keep the other sockets of its reactor waiting */
+#define SAL_Socket_SendFileChunk (1 << 20)
 
-	while (asyncWorkerRunning) {
-		FD_ZERO(&readSet);
+/* size of the buffers multishot receives read into; on the epoll engine each reactor reads into a single buffer of this size */
+#define SAL_Socket_ReceiveBufferSize 4096
 
-		/* iterates over all sockets with registered callbacks. It either finishes when 1024 sockets have been added or the socket list is exhausted. If the socket list is greater than 1024, the position is remembered on the next loop   */
-		for (i = 0, asyncSocket = (SAL_Socket*)AsyncLinkedList_Iterate(&selectIterator); i < FD_SETSIZE && asyncSocket != NULL; i++, asyncSocket = (SAL_Socket*)AsyncLinkedList_Iterate(&selectIterator)) {
-			#ifdef WINDOWS
-				FD_SET((SOCKET)asyncSocket->RawSocket, &readSet);
-			#else defined POSIX
+/* data callbacks get buffers of this size from their reactor's pool, which keeps this many spare */
+#define SAL_Socket_DataBufferSize 16384
+#define SAL_Socket_DataBufferCache 64
 
-			#endif
-		}
-		
-		if (asyncSocket == NULL) /* AsyncLinkedList_Iterate returns NULL when the list is empty. we need to reset it then. */
-			AsyncLinkedList_ResetIterator(&selectIterator);
+#define SAL_Socket_Reactor_Unassigned 0xFFFFFFFF
 
-		select(0, &readSet, NULL, NULL, &selectTimeout);
+/* write queues copy small writes into blocks of this size, and send at most this many blocks in one call */
+#define SAL_Socket_WriteQueueBlockSize 4096
+#define SAL_Socket_WriteQueueMaxVectors 16
 
-		for (i = 0; i < readSet.fd_count; i++) {
-			AsyncLinkedList_ForEach(asyncSocket, &asyncSocketList, SAL_Socket*) {
-				if (asyncSocket->RawSocket == readSet.fd_array[i]) {
-					asyncSocket->ReadCallback(asyncSocket, asyncSocket->ReadCallbackState);
-				}
-			}
-		}
+#define SAL_Socket_CacheLine 64
 
-		SAL_Thread_Sleep(25);
-	}
-	
-	AsyncLinkedList_Uninitialize(&asyncSocketList);
+/* a socket's generation is never 0, so it stands for any; under windows select only hands back descriptors */
+#define SAL_Socket_Generation_Any 0
 
-	return 0;
-#elif defined POSIX
+/* a corked socket sends once this much has built up, as every segment it makes is full by then anyway */
+#define SAL_Socket_CorkLimit 65536
+
+/* the part of a socket the reactor reads for every ready descriptor. It lives in the descriptor table rather than in the socket, one cache line per descriptor, so dispatching a ready socket touches a single line until it actually runs something; the rest of the socket is only read by what runs. */
+typedef struct SAL_Socket_Entry {
+	SAL_Socket* Socket; /* the socket registered with a reactor under this descriptor, or NULL */
+	SAL_Socket_ReadCallback ReadCallback;
+	SAL_Socket_DataCallback DataCallback; /* called with ReadCallbackState as well */
+	void* ReadCallbackState;
+	struct SAL_Socket_Operation* PendingRead;
+	struct SAL_Socket_Operation* PendingWrite;
+	SAL_Socket_ZeroCopyCallback ZeroCopyCallback;
+	uint8 Interest;
+	boolean Closing;
+	uint8 Padding[SAL_Socket_CacheLine - 7 * sizeof(void*) - 2];
+} SAL_Socket_Entry;
+
+/* fails to compile if the padding above is off, as entries would then straddle cache lines */
+typedef uint8 SAL_Socket_Entry_FillsCacheLine[sizeof(SAL_Socket_Entry) == SAL_Socket_CacheLine ? 1 : -1];
+
+struct SAL_Socket {
+	SAL_Socket_Entry* Entry; /* in the descriptor table, or Detached for a descriptor beyond it */
+	#ifdef WINDOWS
+		uint64 RawSocket;
+	#elif defined POSIX
+		int RawSocket;
+	#endif
+	uint32 Reactor;
+	uint32 Operations;
+	struct SAL_Socket_WriteQueue* WriteQueue;
+	void* ZeroCopyCallbackState;
+	uint32 ZeroCopySequence;
+	uint8 Type;
+	uint8 Family;
+	boolean Connected;
+	boolean Sharded;
+	boolean NonBlocking; /* as set with SAL_Socket_SetNonBlocking */
+	uint32 LastError;
+	uint8 RemoteEndpointAddress[SAL_Socket_AddressLength];
+	uint32 Slot;
+	uint32 Generation;
+	SAL_Socket* NextFree;
+	SAL_Socket_Entry Detached;
+};
+
+/* an asynchronous operation. On the io_uring engine it is the user data of its submission; on the epoll engine it waits in PendingRead or PendingWrite until the socket is ready. */
+typedef struct SAL_Socket_Operation {
+	SAL_Socket* Socket;
+	uint8 Type;
+	uint8* Buffer;
+	uint32 Length;
+	uint32 Done;
+	struct addrinfo* AddressInfo;
+	struct sockaddr_storage RemoteAddress; /* filled in by an accept with the peer's address */
+	socklen_t RemoteAddressLength;
+	#ifdef WINDOWS
+		HANDLE File;
+	#elif defined POSIX
+		int File;
+	#endif
+	uint64 FileOffset;
+	uint64 FileRemaining;
+	boolean RestoreBlocking; /* the socket was made non-blocking for the operation */
+	SAL_Frame_Reader* Reader;
+	#ifdef POSIX
+		/* one direction of a relay, from Socket to Destination through Pipe. It is parked as the read of Socket and, while Pipe holds data, as the write of Destination. */
+		struct SAL_Socket_RelayState* Relay;
+		SAL_Socket* Destination;
+		int Pipe[2];
+		uint32 PipeSize;
+		uint32 Buffered;
+		boolean SourceDone;
+	#endif
+	SAL_Socket_CompletionCallback CompletionCallback;
+	SAL_Socket_AcceptCallback AcceptCallback;
+	SAL_Socket_ConnectCallback ConnectCallback;
+	SAL_Socket_ReceiveCallback ReceiveCallback;
+	void* State;
+	boolean Readiness; /* run by the reactor on readiness even on the io_uring engine, when the kernel lacks what the ring version needs */
+} SAL_Socket_Operation;
 
+#ifdef POSIX
+/* two sockets whose data is moved across to each other, one direction per operation */
+typedef struct SAL_Socket_RelayState {
+	SAL_Mutex Lock; /* keeps the reactor off a direction while the other is still being set up */
+	SAL_Socket* Sockets[2];
+	SAL_Socket_Operation* Directions[2]; /* NULL once finished */
+	uint64 Counts[2];
+	int32 Result;
+	SAL_Socket_RelayCallback Callback;
+	void* State;
+} SAL_Socket_RelayState;
 #endif
-}
 
-static void SAL_Socket_CallbackWorker_Initialize() {
-	AsyncLinkedList_Initialize(&asyncSocketList, NULL);
-	asyncWorkerRunning = true;
-	asyncWorker = SAL_Thread_Create(SAL_Socket_CallbackWorker_Run, NULL);
-}
+/* runs @a Callback on a reactor's thread once @a Due (SAL_Time_Now) has passed */
+typedef struct SAL_Socket_Timer {
+	int64 Due;
+	void (*Callback)(void* const state);
+	void* State;
+	boolean Armed;
+	struct SAL_Socket_Timer* Next;
+} SAL_Socket_Timer;
 
-static void SAL_Socket_CallbackWorker_Shutdown() {
-	asyncWorkerRunning = false;
-}
+/* one connection attempt of a race */
+typedef struct {
+	struct SAL_Socket_Race* Race;
+	SAL_Socket* Socket; /* NULL once the attempt has finished */
+} SAL_Socket_RaceAttempt;
 
-static SAL_Socket* SAL_Socket_New(uint8 family, uint8 type) {
-	SAL_Socket* socket;
-	
-	socket = Allocate(SAL_Socket);
-	socket->RawSocket = 0;
-	socket->Connected = false;
-	socket->LastError = 0;
-	socket->ReadCallback = NULL;
-	socket->ReadCallbackState = NULL;
-	socket->Family = family;
-	socket->Type = type;
+/* the addresses of a host being tried against each other, Happy Eyeballs style, until one connects. Everything about a race runs on its reactor's thread. */
+typedef struct SAL_Socket_Race {
+	struct addrinfo** Addresses; /* in the order they are tried, each split off into a list of its own so that its attempt can own it */
+	SAL_Socket_RaceAttempt* Attempts;
+	uint32 Count;
+	uint32 Next; /* the next address to try */
+	uint32 Running; /* attempts started that have not finished */
+	uint32 Reactor;
+	uint8 Type;
+	SAL_Socket_Timer Stagger; /* starts the next attempt if the current ones are taking too long */
+	SAL_Socket_Timer Deadline;
+	SAL_Socket_ConnectCallback Callback;
+	void* State;
+} SAL_Socket_Race;
 
-	return socket;
-}
+/* takes ownership of @a addresses, which is NULL if the name did not resolve */
+typedef void (*SAL_Socket_ResolvedCallback)(struct addrinfo* addresses, void* const state);
 
-static SAL_Socket* SAL_Socket_PrepareRawSocket(const int8* const address, const int8* port, uint8 family, uint8 type, boolean willListenOn, struct addrinfo** addressInfo) {
-	struct addrinfo serverHints;
-	struct addrinfo* serverAddrInfo;
-	SAL_Socket* listener;
+/* a block of data waiting in a write queue. Small writes are appended to the last block while it has room, so that a burst of them goes out in few sends. */
+typedef struct SAL_Socket_QueuedWrite {
+	struct SAL_Socket_QueuedWrite* Next;
+	uint8* Data;
+	uint32 Capacity;
+	uint32 Start; /* sent so far */
+	uint32 End;
+} SAL_Socket_QueuedWrite;
 
-#ifdef WINDOWS
-	SOCKET rawSocket;
+/* data accepted by SAL_Socket_QueueWrite that the socket has not taken yet. The reactor sends it as the socket becomes writable. */
+typedef struct SAL_Socket_WriteQueue {
+	SAL_Mutex Lock; /* taken by producers on any thread, and by the reactor while it flushes */
+	SAL_Socket_QueuedWrite* Head;
+	SAL_Socket_QueuedWrite* Tail;
+	uint32 Queued;
+	uint32 HighWatermark;
+	uint32 LowWatermark;
+	boolean Full; /* went over the high watermark and has not come down to the low one since */
+	int32 Error; /* the first failure to send. Everything queued was dropped and nothing more is accepted. */
+	SAL_Socket_Operation* Operation; /* the flush parked on the socket while anything is queued, unless it is corked */
+	SAL_Socket_CompletionCallback DrainCallback;
+	void* DrainCallbackState;
+	SAL_Semaphore Drained; /* incremented once for each of DrainWaiters when the queue drains */
+	uint32 DrainWaiters; /* threads blocked until the queue comes down to its low watermark */
+	boolean Corked; /* writes only collect in the queue until the socket is flushed */
+	boolean AutoFlush; /* corked by a callback, so its reactor flushes it at the end of the round */
+	SAL_Socket* NextCorked;
+} SAL_Socket_WriteQueue;
 
-	if (!winsockInitialized) {
-		WSADATA startupData;
-		WSAStartup(514, &startupData);
-		winsockInitialized = true;
-	}
+/* an event loop and the thread that runs it. Every socket belongs to one reactor, and all of its callbacks run on that reactor's thread. */
+typedef struct SAL_Socket_Reactor {
+	uint32 Index;
+
+	SAL_Thread Thread;
+	SAL_Mutex Lock; /* guards Alive and Processor */
+	boolean Alive; /* the thread is started with the first work for the reactor and lives as long as the process */
+	uint32 Processor; /* the processor the thread is restricted to, or SAL_Socket_Reactor_Unassigned */
+
+	SAL_Mutex TableLock; /* guards this reactor's entries in the socket table, and Count */
+	uint32 Count;
+
+	/* guards the submission queue and the operation counts, which are changed both by the threads starting operations and by the reactor completing them */
+	SAL_Mutex OperationLock;
+	uint32 Operations;
+
+#ifdef WINDOWS
+	AsyncLinkedList Sockets;
+	SOCKET Wakeup;
+	struct sockaddr_in WakeupAddress;
 #elif defined POSIX
-	int rawSocket;
+	int Epoll;
+	int Wakeup;
+	SAL_Ring Ring;
+	SAL_Ring_Buffers RingBuffers;
+	boolean RingWakePending;
 #endif
 
-	memset(&serverHints, 0, sizeof(struct addrinfo));
+	SAL_Socket* Corked; /* sockets corked by the callbacks of the current round; only touched by the reactor's thread */
 
-	switch (family) {
-		case SAL_Socket_Families_IPV4: serverHints.ai_family = AF_INET; break;
-		case SAL_Socket_Families_IPV6: serverHints.ai_family = AF_INET6; break;
-		case SAL_Socket_Families_IPAny: serverHints.ai_family = AF_UNSPEC; break;
-		default: return NULL;
-	}
+	SAL_Mutex TimerLock; /* guards Timers, which can be armed from any thread */
+	SAL_Socket_Timer* Timers; /* armed timers, soonest first */
 
-	switch (type) {
-		case SAL_Socket_Types_TCP: serverHints.ai_socktype = SOCK_STREAM; break;
-		default: return NULL;
-	}
+	SAL_Buffer_Pool* Buffers; /* what data callbacks are handed */
 
-	if (willListenOn)
-		serverHints.ai_flags = AI_PASSIVE;
-		
-	if (getaddrinfo(address, port, &serverHints, &serverAddrInfo) != 0) {
-		return NULL;
-	}
+	uint8 ReceiveBuffer[SAL_Socket_ReceiveBufferSize];
+} SAL_Socket_Reactor;
 
-	if (serverAddrInfo == NULL) {
-		return NULL;
-	}
-	
-	rawSocket = socket(serverAddrInfo->ai_family, serverAddrInfo->ai_socktype, serverAddrInfo->ai_protocol);
+static void SAL_Socket_Initialize(SAL_Socket* socket);
+static SAL_Socket* SAL_Socket_New(uint8 family, uint8 type, uint64 descriptor);
+static SAL_Socket* SAL_Socket_NewAccepted(SAL_Socket* listener, uint64 descriptor, const struct sockaddr* const remoteAddress);
+static SAL_Socket* SAL_Socket_PrepareRawSocket(const int8* const address, const int8* port, uint8 family, uint8 type, boolean willListenOn, struct addrinfo** addressInfo);
+static void SAL_Socket_Reactor_InitializeAll();
+static boolean SAL_Socket_Reactor_Initialize(SAL_Socket_Reactor* reactor);
+static SAL_Socket_Reactor* SAL_Socket_Reactor_Of(SAL_Socket* socket);
+static uint32 SAL_Socket_Reactor_Next();
+static void SAL_Socket_Reactor_Start(SAL_Socket_Reactor* reactor);
+static void SAL_Socket_Reactor_SetProcessor(SAL_Socket_Reactor* reactor, uint32 processor);
+static void SAL_Socket_Reactor_Wake(SAL_Socket_Reactor* reactor);
+static void SAL_Socket_Reactor_Dispatch(SAL_Socket_Reactor* reactor, uint64 descriptor, uint32 generation, boolean readable, boolean writable, boolean errored);
+static void SAL_Socket_Reactor_FlushCorked(SAL_Socket_Reactor* reactor);
+static void SAL_Socket_Reactor_Uncork(SAL_Socket_Reactor* reactor, SAL_Socket* socket);
+static void SAL_Socket_Reactor_ReceiveData(SAL_Socket_Reactor* reactor, SAL_Socket* socket);
+static int32 SAL_Socket_Reactor_RunTimers(SAL_Socket_Reactor* reactor);
+static void SAL_Socket_Timer_Arm(SAL_Socket_Reactor* reactor, SAL_Socket_Timer* timer, uint32 delay);
+static void SAL_Socket_Timer_Disarm(SAL_Socket_Reactor* reactor, SAL_Socket_Timer* timer);
+static SAL_Thread_Start(SAL_Socket_Reactor_Run);
+static boolean SAL_Socket_UpdateInterest(SAL_Socket* socket);
+static void SAL_Socket_SetBlocking(SAL_Socket* socket, boolean blocking);
+static boolean SAL_Socket_IsBlocking(SAL_Socket* socket);
+static uint8 SAL_Socket_Fail(SAL_Socket* socket, int32 error);
+static uint32 SAL_Socket_AdvanceVectors(SAL_Socket_IOVector** vectors, uint32 count, uint32 sent);
+static uint8 SAL_Socket_SendVectors(SAL_Socket* socket, const SAL_Socket_IOVector* const vectors, const uint32 count, uint32* const sent);
 #ifdef WINDOWS
-	if (rawSocket == INVALID_SOCKET) {
-		closesocket(rawSocket); // It might be invalid, who cares?
-		freeaddrinfo(serverAddrInfo);
-		return NULL;
-	}
+	static boolean SAL_Socket_OpenFile(const int8* const path, HANDLE* file, uint64* size);
+	static int32 SAL_Socket_TransmitFile(SAL_Socket* socket, HANDLE file, uint64* offset, uint64 length);
 #elif defined POSIX
-	if (rawSocket == -1) {
-		close(rawSocket);
-		freeaddrinfo(serverAddrInfo);
-		return NULL;
-	}
+	static boolean SAL_Socket_OpenFile(const int8* const path, int* file, uint64* size);
+	static int32 SAL_Socket_TransmitFile(SAL_Socket* socket, int file, uint64* offset, uint64 length);
+#endif
+#ifdef POSIX
+	static void SAL_Socket_ReceiveNotifications(SAL_Socket* socket);
+	static boolean SAL_Socket_Reactor_ProbeRing(SAL_Socket_Reactor* reactor);
+	static boolean SAL_Socket_Reactor_ProbeMultishot(SAL_Socket_Reactor* reactor);
+	static int32 SAL_Socket_Reactor_RunProbe(SAL_Socket_Reactor* reactor, uint32* flags);
+#endif
+static SAL_Socket_Operation* SAL_Socket_Operation_Begin(SAL_Socket* socket, uint8 type, void* const state);
+static void SAL_Socket_Operation_End(SAL_Socket_Operation* operation);
+static boolean SAL_Socket_Operation_Submit(SAL_Socket_Operation* operation);
+static void SAL_Socket_Operation_Perform(SAL_Socket_Operation* operation);
+static void SAL_Socket_Operation_PerformMultishot(SAL_Socket_Operation* operation);
+static void SAL_Socket_Operation_PerformFrames(SAL_Socket_Operation* operation);
+static void SAL_Socket_Operation_Complete(SAL_Socket_Operation* operation, int32 result);
+#ifdef POSIX
+	static void SAL_Socket_Operation_Deliver(SAL_Socket_Operation* operation, int32 result, uint32 flags);
 #endif
+static boolean SAL_Socket_Operation_CancelAll(SAL_Socket* socket);
+static void SAL_Socket_Operation_Release(SAL_Socket_Operation* operation);
+#ifdef POSIX
+	static void SAL_Socket_Relay_Pump(SAL_Socket_Operation* operation);
+	static void SAL_Socket_Relay_Finish(SAL_Socket_Operation* operation, int32 result);
+#endif
+static SAL_Socket_WriteQueue* SAL_Socket_WriteQueue_Get(SAL_Socket* socket);
+static void SAL_Socket_WriteQueue_Append(SAL_Socket_WriteQueue* queue, const uint8* data, uint32 length);
+static void SAL_Socket_WriteQueue_Discard(SAL_Socket_WriteQueue* queue);
+static int32 SAL_Socket_WriteQueue_Send(SAL_Socket* socket, SAL_Socket_WriteQueue* queue);
+static void SAL_Socket_WriteQueue_Start(SAL_Socket* socket, SAL_Socket_WriteQueue* queue);
+static void SAL_Socket_WriteQueue_Push(SAL_Socket* socket, SAL_Socket_WriteQueue* queue);
+static void SAL_Socket_WriteQueue_Flush(SAL_Socket_Operation* operation);
+static void SAL_Socket_WriteQueue_Schedule(SAL_Socket* socket, SAL_Socket_WriteQueue* queue);
+static boolean SAL_Socket_WriteQueue_Join(SAL_Socket* socket, const SAL_Socket_IOVector* const vectors, const uint32 count, uint32* const written, uint8* const status);
+static boolean SAL_Socket_WriteQueue_IsIdle(SAL_Socket* socket);
+static boolean SAL_Socket_WriteQueue_Wait(SAL_Socket* socket, uint32 milliseconds);
+static boolean SAL_Socket_WaitWritable(SAL_Socket* socket, uint32 milliseconds);
+static boolean SAL_Socket_Resolve_Hints(uint8 family, uint8 type, struct addrinfo* hints);
+static struct addrinfo* SAL_Socket_Resolve(const int8* const address, const int8* port, uint8 family, uint8 type, boolean passive);
+static boolean SAL_Socket_Resolve_Lookup(const int8* const address, const int8* port, uint8 family, uint8 type, struct addrinfo** result);
+static boolean SAL_Socket_Resolve_Cached(const int8* const address, const int8* port, uint8 family, uint8 type, struct addrinfo** result);
+static struct addrinfo* SAL_Socket_Resolve_Query(const int8* const address, const int8* port, uint8 family, uint8 type);
+static void SAL_Socket_Resolve_Queue(const int8* const address, const int8* port, uint8 family, uint8 type, SAL_Socket_ResolvedCallback callback, void* const state);
+static SAL_Thread_Start(SAL_Socket_Resolve_Run);
+static boolean SAL_Socket_Resolve_Port(const int8* const port, uint16* number);
+static struct addrinfo* SAL_Socket_Resolve_Numeric(const int8* const address, const int8* port, int family, int type);
+static struct addrinfo* SAL_Socket_Addresses_Build(int family, const uint8* const address, uint16 port, int type);
+static struct addrinfo* SAL_Socket_Addresses_Local(const int8* const name, int type);
+static struct addrinfo* SAL_Socket_Addresses_Copy(const struct addrinfo* addresses);
+static void SAL_Socket_Addresses_Free(struct addrinfo* addresses);
+static SAL_Socket* SAL_Socket_Open(const struct addrinfo* address, uint8 family, uint8 type);
+static void SAL_Socket_RemoveStale(const struct addrinfo* address);
+static void SAL_Socket_ConnectAsync_Resolved(struct addrinfo* addresses, void* const state);
+static void SAL_Socket_ConnectHappyEyeballs_Resolved(struct addrinfo* addresses, void* const state);
+static void SAL_Socket_ResolveAsync_Resolved(struct addrinfo* addresses, void* const state);
+static boolean SAL_Socket_Race_Start(struct addrinfo* addresses, uint8 type, uint32 timeout, SAL_Socket_ConnectCallback callback, void* const state);
+static boolean SAL_Socket_StartConnect(SAL_Socket* socket, struct addrinfo* address, SAL_Socket_ConnectCallback callback, void* const state);
+static void SAL_Socket_Race_Next(void* const state);
+static void SAL_Socket_Race_Expire(void* const state);
+static void SAL_Socket_Race_Connected(SAL_Socket* socket, void* const state);
+static void SAL_Socket_Race_Finish(SAL_Socket_Race* race, SAL_Socket* winner);
+static void SAL_Socket_Free(SAL_Socket* socket);
+static boolean SAL_Socket_Table_Add(SAL_Socket_Reactor* reactor, SAL_Socket* socket);
+static void SAL_Socket_Table_Remove(SAL_Socket_Reactor* reactor, SAL_Socket* socket);
+static SAL_Socket_Entry* SAL_Socket_Table_Get(uint64 descriptor);
+static SAL_Socket_Entry* SAL_Socket_Table_Attach(uint64 descriptor);
+static SAL_Socket* SAL_Socket_Table_Find(SAL_Socket_Reactor* reactor, uint64 descriptor, uint32 generation);
+static void SAL_Socket_Table_Publish(SAL_Socket_Entry* entry, SAL_Socket* socket);
+static SAL_Socket* SAL_Socket_Slab_Take(void);
+static void SAL_Socket_Slab_Refill(void);
+static void SAL_Socket_Slab_Return(SAL_Socket* socket);
 
-	listener = SAL_Socket_New(family, type);
-	listener->RawSocket = rawSocket;
-	*addressInfo = serverAddrInfo;
+/* the entries of every open socket, indexed by descriptor, and which sockets are registered with a reactor. The table is a directory of fixed size pages that are allocated on first use and never moved, so it can grow without relocating the entries the reactors are reading. The directory is shared, but each entry's Socket is guarded by the lock of the reactor its socket belongs to, so the reactors never contend over it. */
+#define SAL_Socket_Table_PageBits 10
+#define SAL_Socket_Table_PageSize (1 << SAL_Socket_Table_PageBits)
+#define SAL_Socket_Table_Pages 65536
 
-	return listener;
-}
+static SAL_Socket_Entry* socketTable[SAL_Socket_Table_Pages];
+static SAL_Mutex socketTableLock = NULL; /* only taken to allocate pages */
 
+static SAL_Socket_Reactor* reactors = NULL; /* only published once every reactor is initialized */
+static SAL_Mutex reactorsLock = NULL; /* taken to create the reactors, and to change how they will be created */
+static uint32 reactorCount = 0;
+static uint32 nextReactor = 0; /* work that belongs to no socket takes turns over the reactors */
+static uint8 asyncEngine = SAL_Socket_Engines_Epoll;
+#ifdef WINDOWS
+	static __declspec(thread) SAL_Socket_Reactor* currentReactor = NULL;
+#elif defined POSIX
+	static __thread SAL_Socket_Reactor* currentReactor = NULL;
+#endif
 
+/* every socket lives in a slab of the pool, which like the table is a directory of fixed size pages that are never freed or moved. That keeps a closed socket's generation readable, so a stale handle is told apart from a live one without any lock. Each thread keeps the sockets it closes for the next ones it opens, and only goes to the shared free list, under socketSlabLock, to trade batches of them. */
+#define SAL_Socket_Slab_Bits 6
+#define SAL_Socket_Slab_Size (1 << SAL_Socket_Slab_Bits)
+#define SAL_Socket_Slab_Pages 65536
+#define SAL_Socket_Slab_CacheLimit 128 /* a thread holding more free sockets than this hands half of them back */
 
+static SAL_Socket* socketSlabs[SAL_Socket_Slab_Pages];
+static uint32 socketSlabCount = 0;
+static SAL_Socket* socketSlabFree = NULL;
+static SAL_Mutex socketSlabLock = NULL;
+static uint32 socketsLive = 0;
+static uint32 socketsHighWater = 0;
 
-/**
- * Create a TCP connection to a host.
- *
- * @param address A string specifying the hostname to connect to
- * @param port Port to connect to
- */
-SAL_Socket* SAL_Socket_Connect(const int8* const address, const int8* port, uint8 family, uint8 type) {
-	SAL_Socket* server;
-	struct addrinfo* serverAddrInfo;
-	
-	server = SAL_Socket_PrepareRawSocket(address, port, family, type, false, &serverAddrInfo);
-	if (server == NULL) {
-		return NULL;
-	}
-	if (connect(server->RawSocket, serverAddrInfo->ai_addr, (int)serverAddrInfo->ai_addrlen) != 0) {
-		goto error;
-	}
-	
-	freeaddrinfo(serverAddrInfo);
+/* addresses are kept after they are resolved, keyed by everything that went into resolving them. getaddrinfo does not say how long a record may be kept, so an entry lives for a fixed time, and a failure for a shorter one. Lookups only take resolverLock for reading, so connects to hosts in the cache don't wait on each other. */
+#define SAL_Socket_Resolver_Buckets 256
+#define SAL_Socket_Resolver_MaxEntries 4096 /* names resolved beyond this many are not cached until entries expire */
+#define SAL_Socket_Resolver_DefaultTTL 30000
+#define SAL_Socket_Resolver_DefaultNegativeTTL 5000
 
-	server->Connected = true;
+typedef struct SAL_Socket_Resolved {
+	uint32 Hash;
+	int8* Host;
+	int8* Port;
+	uint8 Family;
+	uint8 Type;
+	int64 Expires;
+	struct addrinfo* Addresses; /* NULL if the name did not resolve */
+	struct SAL_Socket_Resolved* Next;
+} SAL_Socket_Resolved;
 
-	return server;
+static SAL_Socket_Resolved* resolverCache[SAL_Socket_Resolver_Buckets];
+static uint32 resolverEntries = 0;
+static SAL_RWLock resolverLock = NULL;
+static uint32 resolverTTL = SAL_Socket_Resolver_DefaultTTL;
+static uint32 resolverNegativeTTL = SAL_Socket_Resolver_DefaultNegativeTTL;
+static SAL_Socket_ResolverStats resolverStats; /* Hits, Numeric and Coalesced are counted atomically, the rest under the write lock */
+static SAL_Socket_ResolverFunction resolverFunction = NULL; /* replaces getaddrinfo if set; guarded by resolverLock */
+static void* resolverFunctionState = NULL;
 
-error:
+/* names that have to wait on the resolver are resolved by a few threads of their own, so that no reactor waits with them. A lookup of a name already being resolved joins that one instead of asking again. */
+#define SAL_Socket_Resolver_Threads 2
+#define SAL_Socket_Resolver_PendingBuckets 64
+
+typedef struct SAL_Socket_LookupWaiter {
+	SAL_Socket_ResolvedCallback Callback;
+	void* State;
+	struct SAL_Socket_LookupWaiter* Next;
+} SAL_Socket_LookupWaiter;
+
+/* a name queued for, or being resolved by, the resolver threads */
+typedef struct SAL_Socket_Lookup {
+	uint32 Hash;
+	int8* Host;
+	int8* Port;
+	uint8 Family;
+	uint8 Type;
+	SAL_Socket_LookupWaiter* Waiters;
+	struct SAL_Socket_Lookup* NextQueued;
+	struct SAL_Socket_Lookup* NextPending;
+} SAL_Socket_Lookup;
+
+/* what a connect waiting on the resolver threads goes on with once the name is resolved */
+typedef struct {
+	uint8 Family;
+	uint8 Type;
+	uint32 Timeout; /* only used by a race */
+	SAL_Socket_ConnectCallback Callback;
+	void* State;
+	SAL_Socket_Timer Failure; /* posts a failure to a reactor, where the callback runs as it does for every other outcome */
+} SAL_Socket_PendingConnect;
+
+typedef struct {
+	SAL_Socket_ResolveCallback Callback;
+	void* State;
+} SAL_Socket_PendingResolve;
+
+static SAL_Mutex resolverQueueLock = NULL; /* guards the queue and resolverPending */
+static SAL_Semaphore resolverQueued = NULL; /* counts the queued lookups; created, and the threads started, by the first */
+static SAL_Socket_Lookup* resolverQueueHead = NULL;
+static SAL_Socket_Lookup* resolverQueueTail = NULL;
+static SAL_Socket_Lookup* resolverPending[SAL_Socket_Resolver_PendingBuckets]; /* queued or being resolved, by name */
 #ifdef WINDOWS
-	closesocket(server->RawSocket); // It might be invalid, who cares?
+	static __declspec(thread) SAL_Socket* socketSlabCache = NULL;
+	static __declspec(thread) uint32 socketSlabCached = 0;
 #elif defined POSIX
-	close(server->RawSocket);
+	static __thread SAL_Socket* socketSlabCache = NULL;
+	static __thread uint32 socketSlabCached = 0;
 #endif
-	freeaddrinfo(serverAddrInfo);
-	Free(server);
 
-	return NULL;
+/* the locks above are created together, exactly once, by whichever thread needs one first */
+#ifdef WINDOWS
+	static INIT_ONCE socketGlobalsOnce = INIT_ONCE_STATIC_INIT;
+#elif defined POSIX
+	static pthread_once_t socketGlobalsOnce = PTHREAD_ONCE_INIT;
+#endif
+
+static void SAL_Socket_Globals_Create(void) {
+	socketTableLock = SAL_Mutex_Create();
+	socketSlabLock = SAL_Mutex_Create();
+	resolverLock = SAL_RWLock_Create();
+	resolverQueueLock = SAL_Mutex_Create();
+	reactorsLock = SAL_Mutex_Create();
 }
 
-/**
- * Create a listening socket on all interfaces.
- *
- * @param port String with the port number or name (e.g, "http" or "80")
- * @returns a socket you can call @ref SAL_Socket_Accept on
- */
-SAL_Socket* SAL_Socket_Listen(const int8* const port, uint8 family, uint8 type) {
-	SAL_Socket* listener;
-	struct addrinfo* serverAddrInfo;
+#ifdef WINDOWS
+static BOOL CALLBACK SAL_Socket_Globals_CreateOnce(PINIT_ONCE once, PVOID parameter, PVOID* context) {
+	SAL_Socket_Globals_Create();
 
-	listener = SAL_Socket_PrepareRawSocket(NULL, port, family, type, false, &serverAddrInfo);
-	if (listener == NULL) {
+	return TRUE;
+}
+#endif
+
+/* makes sure the global locks exist; cheap once they do */
+static void SAL_Socket_Globals_Initialize(void) {
+#ifdef WINDOWS
+	InitOnceExecuteOnce(&socketGlobalsOnce, SAL_Socket_Globals_CreateOnce, NULL, NULL);
+#elif defined POSIX
+	pthread_once(&socketGlobalsOnce, SAL_Socket_Globals_Create);
+#endif
+}
+
+/* the entry for @a descriptor, or NULL if its page was never allocated or it is beyond the table */
+static SAL_Socket_Entry* SAL_Socket_Table_Get(uint64 descriptor) {
+	uint64 page;
+
+	page = descriptor >> SAL_Socket_Table_PageBits;
+	if (page >= SAL_Socket_Table_Pages || socketTable[page] == NULL)
 		return NULL;
-	}
 
-	if (bind(listener->RawSocket, serverAddrInfo->ai_addr, (int)serverAddrInfo->ai_addrlen) != 0) {
-		goto error;
-	}
+	return &socketTable[page][descriptor & (SAL_Socket_Table_PageSize - 1)];
+}
 
-	if (listen(listener->RawSocket, SOMAXCONN) != 0) {
-		goto error;
+/* the entry a new socket gets for @a descriptor, cleared, or NULL if the descriptor is beyond the table. Pages are aligned to a cache line so that each entry is exactly one. */
+static SAL_Socket_Entry* SAL_Socket_Table_Attach(uint64 descriptor) {
+	SAL_Socket_Entry* entry;
+	uint8* memory;
+	uint64 page;
+
+	page = descriptor >> SAL_Socket_Table_PageBits;
+	if (page >= SAL_Socket_Table_Pages)
+		return NULL;
+
+	SAL_Socket_Globals_Initialize();
+
+	SAL_Mutex_Acquire(socketTableLock);
+
+	if (socketTable[page] == NULL) {
+		memory = AllocateArray(uint8, SAL_Socket_Table_PageSize * sizeof(SAL_Socket_Entry) + SAL_Socket_CacheLine - 1);
+		memory += (SAL_Socket_CacheLine - (size_t)memory % SAL_Socket_CacheLine) % SAL_Socket_CacheLine;
+		memset(memory, 0, SAL_Socket_Table_PageSize * sizeof(SAL_Socket_Entry));
+		socketTable[page] = (SAL_Socket_Entry*)memory;
 	}
-	
-	freeaddrinfo(serverAddrInfo);
 
-	listener->Connected = true;
+	SAL_Mutex_Release(socketTableLock);
 
-	return listener;
+	/* the descriptor is new, so only a reactor holding a stale event for its last socket can still be looking at the entry; it reads Socket alone, and finds it cleared */
+	entry = &socketTable[page][descriptor & (SAL_Socket_Table_PageSize - 1)];
+	SAL_Socket_Table_Publish(entry, NULL);
+	memset((uint8*)entry + sizeof(entry->Socket), 0, sizeof(SAL_Socket_Entry) - sizeof(entry->Socket));
 
-error:
-#ifdef WINDOWS
-	closesocket(listener->RawSocket); // It might be invalid, who cares?
-#elif defined POSIX
-	close(listener->RawSocket);
-#endif
-	freeaddrinfo(serverAddrInfo);
-	Free(listener);
+	return entry;
+}
 
-	return NULL;
+static boolean SAL_Socket_Table_Add(SAL_Socket_Reactor* reactor, SAL_Socket* socket) {
+	if (socket->Entry == &socket->Detached)
+		return false;
+
+	SAL_Mutex_Acquire(reactor->TableLock);
+	SAL_Socket_Table_Publish(socket->Entry, socket);
+	reactor->Count++;
+	SAL_Mutex_Release(reactor->TableLock);
+
+	return true;
 }
 
-/**
- * Accept an incoming connection on a listening socket (one created by @ref
- * SAL_Socket_Listen).
- *
- * @param listener The listening socket to accept a connection on
- * @param acceptedAddress 4 network bytes representing the client's IP address
- *
- * @warning This function is currently broken and platform-dependent
- */
-SAL_Socket* SAL_Socket_Accept(SAL_Socket* listener) {
+static void SAL_Socket_Table_Remove(SAL_Socket_Reactor* reactor, SAL_Socket* socket) {
+	SAL_Mutex_Acquire(reactor->TableLock);
+	SAL_Socket_Table_Publish(socket->Entry, NULL);
+	reactor->Count--;
+	SAL_Mutex_Release(reactor->TableLock);
+}
+
+/* returns the socket registered for @a descriptor if it is the one of @a generation, or of any generation for SAL_Socket_Generation_Any, and belongs to @a reactor. Otherwise it returns NULL: the socket was unregistered after the reactor was told it was ready, or closed and its descriptor reused. Lookups take no lock. The slabs are never freed, so the generation of a socket closed meanwhile can still be read, and tells it apart. */
+static SAL_Socket* SAL_Socket_Table_Find(SAL_Socket_Reactor* reactor, uint64 descriptor, uint32 generation) {
+	SAL_Socket_Entry* entry;
 	SAL_Socket* socket;
-	struct sockaddr_in6 remoteAddress;
-	int addressLength = sizeof(struct sockaddr_in6);
+
+	entry = SAL_Socket_Table_Get(descriptor);
+	if (entry == NULL)
+		return NULL;
 
 #ifdef WINDOWS
-	SOCKET rawSocket;
-	
-	rawSocket = accept((SOCKET)listener->RawSocket, NULL, NULL); /* (struct sockaddr*)&remoteAddress, &addressLength); */
-	if (rawSocket == INVALID_SOCKET) {
+	socket = (SAL_Socket*)InterlockedCompareExchangePointer((volatile PVOID*)&entry->Socket, NULL, NULL);
+	if (socket == NULL || (generation != SAL_Socket_Generation_Any && (uint32)InterlockedCompareExchange((volatile LONG*)&socket->Generation, 0, 0) != generation))
 		return NULL;
-	}
 #elif defined POSIX
-	int rawSocket;
-
-	rawSocket = accept(listener->RawSocket, NULL, NULL);
-	if (sock_fd == -1) {
+	socket = __atomic_load_n(&entry->Socket, __ATOMIC_ACQUIRE);
+	if (socket == NULL || (generation != SAL_Socket_Generation_Any && __atomic_load_n(&socket->Generation, __ATOMIC_RELAXED) != generation))
 		return NULL;
-	}
-	
 #endif
 
-	socket = SAL_Socket_New(listener->Family, listener->Type);
-	socket->RawSocket = rawSocket;
-	socket->Connected = true;
-
-	return socket;
+	return socket->Reactor == reactor->Index ? socket : NULL;
 }
 
-/**
- * Disconnect and close the socket.
- *
- * @param socket Socket to close
- */
-void SAL_Socket_Close(SAL_Socket* socket) {
-	assert(socket != NULL);
-
-	SAL_Socket_UnsetSocketCallback(socket);
-	socket->Connected = false;
+/* sets the socket registered under @a entry, so that a reactor reading it without a lock sees the socket whole */
+static void SAL_Socket_Table_Publish(SAL_Socket_Entry* entry, SAL_Socket* socket) {
 #ifdef WINDOWS
-	shutdown((SOCKET)socket->RawSocket, SD_BOTH);
-	closesocket((SOCKET)socket->RawSocket);
-	socket->RawSocket = INVALID_SOCKET;
+	InterlockedExchangePointer((volatile PVOID*)&entry->Socket, socket);
 #elif defined POSIX
-	shutdown(socket->RawSocket, SHUT_RDWR);
-	close(socket->RawSocket);
-	socket->RawSocket = -1;
+	__atomic_store_n(&entry->Socket, socket, __ATOMIC_RELEASE);
 #endif
-	Free(socket);
 }
 
-/**
- * Read up to @a bufferSize bytes into @a buffer from @a socket.
- *
- * @param socket Socket to read from
- * @param buffer Address to write the read data too
- * @param bufferSize Size of @a buffer
- * @returns Number of bytes read
- */
-uint32 SAL_Socket_Read(SAL_Socket* socket, uint8* const buffer, const uint32 bufferSize) {
-	int32 received;
+/* takes a socket from the calling thread's cache, refilling it first if it is empty */
+static SAL_Socket* SAL_Socket_Slab_Take(void) {
+	SAL_Socket* socket;
+	uint32 live;
+	uint32 highWater;
 
-	assert(buffer != NULL);
-	assert(socket != NULL);
+	if (socketSlabCache == NULL)
+		SAL_Socket_Slab_Refill();
+
+	socket = socketSlabCache;
+	socketSlabCache = socket->NextFree;
+	socketSlabCached--;
+	socket->NextFree = NULL;
 
 #ifdef WINDOWS
-	received = recv((SOCKET)socket->RawSocket, (int8* const)buffer, bufferSize, 0);
+	live = (uint32)InterlockedIncrement((volatile LONG*)&socketsLive);
+	while ((highWater = socketsHighWater) < live && (uint32)InterlockedCompareExchange((volatile LONG*)&socketsHighWater, (LONG)live, (LONG)highWater) != highWater)
+		;
 #elif defined POSIX
-	received = recv(socket->RawSocket, (int8* const)buffer, bufferSize, 0);
+	live = __atomic_add_fetch(&socketsLive, 1, __ATOMIC_RELAXED);
+	highWater = __atomic_load_n(&socketsHighWater, __ATOMIC_RELAXED);
+	while (highWater < live && !__atomic_compare_exchange_n(&socketsHighWater, &highWater, live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
 #endif
 
-	if (received <= 0)
-		return 0;
-
-	return (uint32)received;
+	return socket;
 }
 
-/**
- * Send @a writeAmount bytes from @a toWrite over @a socket.
- *
- * @param socket Socket to write to
- * @param toWrite Buffer to write from
- * @param writeAmount Number of bytes to write
- * @returns number of bytes sent.
- */
-uint32 SAL_Socket_Write(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount) {
-	int32 result;
+/* moves a batch of sockets from the shared free list to the calling thread's cache, allocating a new slab if the list is empty */
+static void SAL_Socket_Slab_Refill(void) {
+	SAL_Socket* slab;
+	SAL_Socket* socket;
+	uint32 i;
 
-	assert(socket != NULL);
-	assert(toWrite != NULL);
+	SAL_Socket_Globals_Initialize();
 
-#ifdef WINDOWS
-	result = send((SOCKET)socket->RawSocket, (const int8*)toWrite, writeAmount, 0);
-#elif defined POSIX
-	result = send(socket->RawSocket, (const int8*)toWrite, writeAmount, 0);
-#endif
+	SAL_Mutex_Acquire(socketSlabLock);
 
-	return (uint32)result;
-}
+	for (i = 0; i < SAL_Socket_Slab_CacheLimit / 2 && (socket = socketSlabFree) != NULL; i++) {
+		socketSlabFree = socket->NextFree;
+		socket->NextFree = socketSlabCache;
+		socketSlabCache = socket;
+		socketSlabCached++;
+	}
 
-/**
- * Send @a writeAmount bytes from @a toWrite over @a socket trying @a maxAttempts times to send the data before giving up.
- *
- * @param socket Socket to write to
- * @param toWrite Buffer to write from
- * @param writeAmount Number of bytes to write
- * @param maxAttempts Number of times to try and send all the data
- * @returns the number of bytes that were sent.
- */
-uint32 SAL_Socket_EnsureWrite(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, uint8 maxAttempts) {
-	uint32 sentSoFar;
-	int32 result;
-	uint8 tries;
-	boolean isFirstTry;
+	if (socketSlabCache == NULL) {
+		assert(socketSlabCount < SAL_Socket_Slab_Pages);
 
-	assert(socket != NULL);
-	assert(toWrite != NULL);
+		slab = AllocateArray(SAL_Socket, SAL_Socket_Slab_Size);
+		for (i = SAL_Socket_Slab_Size; i > 0; i--) {
+			socket = &slab[i - 1];
+			socket->Slot = (socketSlabCount << SAL_Socket_Slab_Bits) | (i - 1);
+			socket->Generation = 1;
+			socket->NextFree = socketSlabCache;
+			socketSlabCache = socket;
+		}
 
-	sentSoFar = 0;
-	tries = 0;
-	isFirstTry = true;
+		socketSlabCached += SAL_Socket_Slab_Size;
 
-	while (true) {
-	
+		/* the slab is filled in before it can be found by a handle */
 		#ifdef WINDOWS
-			result = send((SOCKET)socket->RawSocket, (const int8*)(toWrite + sentSoFar), writeAmount - sentSoFar, 0);
-			if (result != SOCKET_ERROR)
-				sentSoFar += result;
+			MemoryBarrier();
 		#elif defined POSIX
-			result = send(socket->RawSocket, (const int8*)(toWrite + sentSoFar), writeAmount - sentSoFar, 0);
-			if (result != -1)
-				sentSoFar += result;
+			__atomic_thread_fence(__ATOMIC_RELEASE);
 		#endif
 
-		tries++;
+		socketSlabs[socketSlabCount++] = slab;
+	}
 
-		if (sentSoFar == writeAmount || tries == maxAttempts)
-			break;
+	SAL_Mutex_Release(socketSlabLock);
+}
+
+/* puts a closed socket in the calling thread's cache. Its generation moves on first, which is what invalidates the handles to it. */
+static void SAL_Socket_Slab_Return(SAL_Socket* socket) {
+	SAL_Socket* last;
+	SAL_Socket* kept;
+	uint32 generation;
+	uint32 i;
+
+	/* reactors read it without a lock to tell a stale event from a live one */
+	generation = socket->Generation + 1;
+	if (generation == 0)
+		generation = 1;
+
+	#ifdef WINDOWS
+		InterlockedExchange((volatile LONG*)&socket->Generation, (LONG)generation);
+	#elif defined POSIX
+		__atomic_store_n(&socket->Generation, generation, __ATOMIC_RELAXED);
+	#endif
+
+	socket->NextFree = socketSlabCache;
+	socketSlabCache = socket;
+	socketSlabCached++;
+
+#ifdef WINDOWS
+	InterlockedDecrement((volatile LONG*)&socketsLive);
+#elif defined POSIX
+	__atomic_sub_fetch(&socketsLive, 1, __ATOMIC_RELAXED);
+#endif
+
+	if (socketSlabCached <= SAL_Socket_Slab_CacheLimit)
+		return;
+
+	/* a thread that closes more than it opens, such as a reactor closing accepted connections, passes the surplus on to the threads that open them */
+	for (last = socketSlabCache, i = 1; i < SAL_Socket_Slab_CacheLimit / 2; i++)
+		last = last->NextFree;
+
+	kept = last->NextFree;
+
+	SAL_Mutex_Acquire(socketSlabLock);
+	last->NextFree = socketSlabFree;
+	socketSlabFree = socketSlabCache;
+	SAL_Mutex_Release(socketSlabLock);
+
+	socketSlabCache = kept;
+	socketSlabCached -= SAL_Socket_Slab_CacheLimit / 2;
+}
+
+static SAL_Thread_Start(SAL_Socket_Reactor_Run) {
+	SAL_Socket_Reactor* reactor;
+#ifdef WINDOWS
+	fd_set readSet;
+	fd_set writeSet;
+	fd_set exceptSet;
+	uint32 i;
+	SAL_Socket* asyncSocket;
+	AsyncLinkedList_Iterator selectIterator;
+	struct timeval selectTimeout;
+	struct timeval timerTimeout;
+	int32 timeout;
+	int8 wakeupData;
+
+	reactor = (SAL_Socket_Reactor*)startupArgument;
+	currentReactor = reactor;
+
+	AsyncLinkedList_InitializeIterator(&selectIterator, &reactor->Sockets);
+	selectTimeout.tv_usec = 250;
+	selectTimeout.tv_sec = 0;
+
+	while (true) {
+		timeout = SAL_Socket_Reactor_RunTimers(reactor);
+		timerTimeout.tv_sec = timeout / 1000;
+		timerTimeout.tv_usec = (timeout % 1000) * 1000;
+
+		FD_ZERO(&readSet);
+		FD_ZERO(&writeSet);
+		FD_ZERO(&exceptSet);
+		FD_SET(reactor->Wakeup, &readSet);
+
+		/* iterates over all sockets with registered callbacks. It either finishes when the set is full (the wakeup socket takes one slot) or the socket list is exhausted. If the socket list is greater than that, the position is remembered on the next loop   */
+		for (i = 1, asyncSocket = (SAL_Socket*)AsyncLinkedList_Iterate(&selectIterator); i < FD_SETSIZE && asyncSocket != NULL; i++, asyncSocket = (SAL_Socket*)AsyncLinkedList_Iterate(&selectIterator)) {
+			if (asyncSocket->Entry->Interest & SAL_Socket_Interest_Read)
+				FD_SET((SOCKET)asyncSocket->RawSocket, &readSet);
+
+			/* a failed connect is reported through the except set rather than the write set */
+			if (asyncSocket->Entry->Interest & SAL_Socket_Interest_Write) {
+				FD_SET((SOCKET)asyncSocket->RawSocket, &writeSet);
+				FD_SET((SOCKET)asyncSocket->RawSocket, &exceptSet);
+			}
+		}
+		
+		if (asyncSocket == NULL) /* AsyncLinkedList_Iterate returns NULL when the list is empty. we need to reset it then. */
+			AsyncLinkedList_ResetIterator(&selectIterator);
+
+		/* block until something is ready, the wakeup socket is signalled or a timer is due, unless sockets were left out of this set and need their turn */
+		select(0, &readSet, &writeSet, &exceptSet, asyncSocket != NULL ? &selectTimeout : (timeout >= 0 ? &timerTimeout : NULL));
+
+		for (i = 0; i < writeSet.fd_count; i++)
+			SAL_Socket_Reactor_Dispatch(reactor, (uint64)writeSet.fd_array[i], SAL_Socket_Generation_Any, false, true, false);
+
+		for (i = 0; i < exceptSet.fd_count; i++)
+			SAL_Socket_Reactor_Dispatch(reactor, (uint64)exceptSet.fd_array[i], SAL_Socket_Generation_Any, false, true, false);
+
+		for (i = 0; i < readSet.fd_count; i++) {
+			if (readSet.fd_array[i] == reactor->Wakeup) {
+				recv(reactor->Wakeup, &wakeupData, sizeof(wakeupData), 0);
+				continue;
+			}
+
+			SAL_Socket_Reactor_Dispatch(reactor, (uint64)readSet.fd_array[i], SAL_Socket_Generation_Any, true, false, false);
+		}
+
+		SAL_Socket_Reactor_FlushCorked(reactor);
+	}
+#elif defined POSIX
+	struct epoll_event events[SAL_Socket_Reactor_MaxEvents];
+	struct io_uring_cqe* completion;
+	SAL_Socket_Operation* operation;
+	uint64 wakeupCount;
+	uint32 flags;
+	int32 result;
+	int32 timeout;
+	int count;
+	int i;
+
+	reactor = (SAL_Socket_Reactor*)startupArgument;
+	currentReactor = reactor;
+
+	while (true) {
+		timeout = SAL_Socket_Reactor_RunTimers(reactor);
+
+		/* everything queued since the last round, including by the callbacks of that round, goes to the kernel in one call */
+		if (asyncEngine == SAL_Socket_Engines_IOUring) {
+			SAL_Mutex_Acquire(reactor->OperationLock);
+			reactor->RingWakePending = false;
+			SAL_Ring_Submit(&reactor->Ring, 0);
+			SAL_Mutex_Release(reactor->OperationLock);
+		}
+
+		count = epoll_wait(reactor->Epoll, events, SAL_Socket_Reactor_MaxEvents, timeout);
+
+		/* events carry the descriptor and the socket's generation rather than the socket, so that a socket closed by an earlier callback in this batch, or by another thread, is simply not found, even once its descriptor has been reused */
+		for (i = 0; i < count; i++) {
+			if (events[i].data.u64 == (uint64)reactor->Wakeup) {
+				read(reactor->Wakeup, &wakeupCount, sizeof(wakeupCount));
+				continue;
+			}
+
+			if (events[i].data.u64 == (uint64)reactor->Ring.Descriptor && asyncEngine == SAL_Socket_Engines_IOUring) {
+				while ((completion = SAL_Ring_PeekCompletion(&reactor->Ring)) != NULL) {
+					operation = (SAL_Socket_Operation*)(size_t)completion->user_data;
+					result = completion->res;
+					flags = completion->flags;
+
+					/* released before the callback runs so that it can queue more work */
+					SAL_Ring_AdvanceCompletions(&reactor->Ring, 1);
+
+					if (operation != NULL) /* cancellation requests carry no operation */
+						SAL_Socket_Operation_Deliver(operation, result, flags);
+				}
+
+				continue;
+			}
+
+			SAL_Socket_Reactor_Dispatch(reactor, events[i].data.u64 & 0xFFFFFFFF, (uint32)(events[i].data.u64 >> 32), (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0, (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0, (events[i].events & EPOLLERR) != 0);
+		}
+
+		/* what the callbacks of this round wrote to corked sockets goes out together, in full segments */
+		SAL_Socket_Reactor_FlushCorked(reactor);
+	}
+#endif
+
+	return 0;
+}
+
+/* runs whatever is waiting on a ready descriptor: zero copy notifications, a pending operation, or the read or data callback */
+static void SAL_Socket_Reactor_Dispatch(SAL_Socket_Reactor* reactor, uint64 descriptor, uint32 generation, boolean readable, boolean writable, boolean errored) {
+	SAL_Socket_Entry* entry;
+	SAL_Socket* asyncSocket;
+
+	asyncSocket = SAL_Socket_Table_Find(reactor, descriptor, generation);
+	if (asyncSocket == NULL)
+		return;
+
+	/* everything up to running a callback or an operation is read from the entry; past the check above, the socket itself isn't touched */
+	entry = SAL_Socket_Table_Get(descriptor);
+	generation = asyncSocket->Generation;
+
+#ifdef POSIX
+	if (errored && entry->ZeroCopyCallback != NULL) {
+		SAL_Socket_ReceiveNotifications(asyncSocket);
+
+		/* the callback may have closed the socket */
+		if (SAL_Socket_Table_Find(reactor, descriptor, generation) != asyncSocket)
+			return;
+	}
+#endif
+
+	if (writable && entry->PendingWrite != NULL) {
+		SAL_Socket_Operation_Perform(entry->PendingWrite);
+
+		/* the completion callback may have closed the socket */
+		if (SAL_Socket_Table_Find(reactor, descriptor, generation) != asyncSocket)
+			return;
+	}
+
+	if (readable) {
+		if (entry->PendingRead != NULL && (entry->PendingRead->Type == SAL_Socket_Operations_AcceptMultishot || entry->PendingRead->Type == SAL_Socket_Operations_ReceiveMultishot))
+			SAL_Socket_Operation_PerformMultishot(entry->PendingRead);
+		else if (entry->PendingRead != NULL)
+			SAL_Socket_Operation_Perform(entry->PendingRead);
+		else if (entry->ReadCallback != NULL)
+			entry->ReadCallback(asyncSocket, entry->ReadCallbackState);
+		else if (entry->DataCallback != NULL)
+			SAL_Socket_Reactor_ReceiveData(reactor, asyncSocket);
+	}
+}
+
+/* reads what is waiting on @a socket into a buffer from the reactor's pool and hands it to the data callback. One read per wakeup keeps a busy connection from starving the others; whatever is left makes the socket ready again. Running out of data, or an error, is passed on as a length of 0 and unregisters the callback. */
+static void SAL_Socket_Reactor_ReceiveData(SAL_Socket_Reactor* reactor, SAL_Socket* socket) {
+	SAL_Socket_DataCallback callback;
+	SAL_Buffer* buffer;
+	void* state;
+	int32 result;
+
+	buffer = SAL_Buffer_Get(reactor->Buffers);
+
+#ifdef WINDOWS
+	result = recv((SOCKET)socket->RawSocket, (int8*)buffer->Data, buffer->Size, 0);
+	if (result < 0 && WSAGetLastError() == WSAEWOULDBLOCK) {
+		SAL_Buffer_Release(buffer);
+		return;
+	}
+#elif defined POSIX
+	do
+		result = recv(socket->RawSocket, buffer->Data, buffer->Size, MSG_DONTWAIT);
+	while (result < 0 && errno == EINTR);
+
+	if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+		SAL_Buffer_Release(buffer);
+		return;
+	}
+#endif
+
+	callback = socket->Entry->DataCallback;
+	state = socket->Entry->ReadCallbackState;
+
+	if (result <= 0) {
+		SAL_Buffer_Release(buffer);
+
+		socket->Entry->DataCallback = NULL;
+		socket->Entry->ReadCallbackState = NULL;
+		SAL_Socket_UpdateInterest(socket);
+
+		callback(socket, NULL, NULL, 0, state);
+		return;
+	}
+
+	callback(socket, buffer, buffer->Data, (uint32)result, state);
+
+	SAL_Buffer_Release(buffer);
+}
+
+/* runs the timers that are due and returns how long the reactor may wait for the next, in milliseconds, or -1 if none is armed */
+static int32 SAL_Socket_Reactor_RunTimers(SAL_Socket_Reactor* reactor) {
+	SAL_Socket_Timer* timer;
+	int64 now;
+	int64 wait;
+
+	while (true) {
+		now = SAL_Time_Now();
+
+		SAL_Mutex_Acquire(reactor->TimerLock);
+
+		timer = reactor->Timers;
+		if (timer == NULL || timer->Due > now)
+			break;
+
+		reactor->Timers = timer->Next;
+		timer->Armed = false;
+		timer->Next = NULL;
+
+		SAL_Mutex_Release(reactor->TimerLock);
+
+		/* the callback is free to arm or disarm timers, this one included */
+		timer->Callback(timer->State);
+	}
+
+	wait = timer != NULL ? timer->Due - now : -1;
+
+	SAL_Mutex_Release(reactor->TimerLock);
+
+	return wait > 0x7FFFFFFF ? 0x7FFFFFFF : (int32)wait;
+}
+
+/* arms @a timer to run on @a reactor's thread after @a delay milliseconds, moving it if it was armed already */
+static void SAL_Socket_Timer_Arm(SAL_Socket_Reactor* reactor, SAL_Socket_Timer* timer, uint32 delay) {
+	SAL_Socket_Timer** link;
+	boolean first;
+
+	SAL_Socket_Timer_Disarm(reactor, timer);
+
+	SAL_Mutex_Acquire(reactor->TimerLock);
+
+	timer->Due = SAL_Time_Now() + delay;
+	timer->Armed = true;
+
+	for (link = &reactor->Timers; *link != NULL && (*link)->Due <= timer->Due; link = &(*link)->Next)
+		;
+
+	timer->Next = *link;
+	*link = timer;
+	first = link == &reactor->Timers;
+
+	SAL_Mutex_Release(reactor->TimerLock);
+
+	/* the reactor works out its wait again at the start of each round, so it only needs waking from another thread */
+	if (currentReactor != reactor) {
+		SAL_Socket_Reactor_Start(reactor);
+
+		if (first)
+			SAL_Socket_Reactor_Wake(reactor);
+	}
+}
+
+static void SAL_Socket_Timer_Disarm(SAL_Socket_Reactor* reactor, SAL_Socket_Timer* timer) {
+	SAL_Socket_Timer** link;
+
+	SAL_Mutex_Acquire(reactor->TimerLock);
+
+	if (timer->Armed) {
+		for (link = &reactor->Timers; *link != timer; link = &(*link)->Next)
+			;
+
+		*link = timer->Next;
+		timer->Next = NULL;
+		timer->Armed = false;
+	}
+
+	SAL_Mutex_Release(reactor->TimerLock);
+}
+
+/* flushes the sockets corked by the callbacks of the round that just ended, unless they were flushed already */
+static void SAL_Socket_Reactor_FlushCorked(SAL_Socket_Reactor* reactor) {
+	SAL_Socket* socket;
+
+	while ((socket = reactor->Corked) != NULL) {
+		reactor->Corked = socket->WriteQueue->NextCorked;
+		socket->WriteQueue->NextCorked = NULL;
+		socket->WriteQueue->AutoFlush = false;
+
+		SAL_Socket_Flush(socket);
+	}
+}
+
+/* takes @a socket off the list of sockets @a reactor flushes at the end of the round, as it is being closed */
+static void SAL_Socket_Reactor_Uncork(SAL_Socket_Reactor* reactor, SAL_Socket* socket) {
+	SAL_Socket** link;
+
+	for (link = &reactor->Corked; *link != NULL; link = &(*link)->WriteQueue->NextCorked) {
+		if (*link == socket) {
+			*link = socket->WriteQueue->NextCorked;
+			break;
+		}
+	}
+
+	socket->WriteQueue->NextCorked = NULL;
+	socket->WriteQueue->AutoFlush = false;
+}
+
+/* creates every reactor, once, whichever thread gets there first. Their threads are only started once they have something to wait on. If any of them can't get a ring, they all fall back to epoll so that sockets behave the same whichever reactor they land on. */
+static void SAL_Socket_Reactor_InitializeAll() {
+	SAL_Socket_Reactor* created;
+	uint32 i;
+#ifdef POSIX
+	uint32 j;
+#endif
+
+#ifdef WINDOWS
+	if (InterlockedCompareExchangePointer((PVOID volatile*)&reactors, NULL, NULL) != NULL)
+		return;
+#elif defined POSIX
+	if (__atomic_load_n(&reactors, __ATOMIC_ACQUIRE) != NULL)
+		return;
+#endif
+
+	SAL_Socket_Globals_Initialize();
+
+	SAL_Mutex_Acquire(reactorsLock);
+
+	if (reactors != NULL) {
+		SAL_Mutex_Release(reactorsLock);
+		return;
+	}
+
+	if (reactorCount == 0)
+		reactorCount = SAL_Thread_GetProcessorCount();
+
+	created = AllocateArray(SAL_Socket_Reactor, reactorCount);
+
+	for (i = 0; i < reactorCount; i++) {
+		created[i].Index = i;
+
+		if (!SAL_Socket_Reactor_Initialize(&created[i])) {
+			#ifdef POSIX
+				for (j = 0; j < i; j++) {
+					if (created[j].RingBuffers.Ring != NULL)
+						SAL_Ring_UnregisterBuffers(&created[j].Ring, &created[j].RingBuffers);
+
+					epoll_ctl(created[j].Epoll, EPOLL_CTL_DEL, created[j].Ring.Descriptor, NULL);
+					SAL_Ring_Uninitialize(&created[j].Ring);
+					created[j].Ring.Descriptor = -1;
+				}
+			#endif
+
+			asyncEngine = SAL_Socket_Engines_Epoll;
+		}
+	}
+
+	/* a thread that finds reactors set without the lock must find every one of them ready */
+#ifdef WINDOWS
+	InterlockedExchangePointer((PVOID volatile*)&reactors, created);
+#elif defined POSIX
+	__atomic_store_n(&reactors, created, __ATOMIC_RELEASE);
+#endif
+
+	SAL_Mutex_Release(reactorsLock);
+}
+
+/* creates the state shared by every run of a reactor's thread: the kernel wait object, the wakeup descriptor that interrupts it and, for the io_uring engine, the ring. returns false if the ring could not be created. */
+static boolean SAL_Socket_Reactor_Initialize(SAL_Socket_Reactor* reactor) {
+#ifdef WINDOWS
+	int addressLength;
+#elif defined POSIX
+	struct epoll_event event;
+	uint32 bufferCount;
+#endif
+
+	reactor->Lock = SAL_Mutex_Create();
+	reactor->Alive = false;
+	reactor->Processor = SAL_Socket_Reactor_Unassigned;
+	reactor->TableLock = SAL_Mutex_Create();
+	reactor->Count = 0;
+	reactor->OperationLock = SAL_Mutex_Create();
+	reactor->Operations = 0;
+	reactor->Corked = NULL;
+	reactor->TimerLock = SAL_Mutex_Create();
+	reactor->Timers = NULL;
+	reactor->Buffers = SAL_Buffer_Pool_Create(SAL_Socket_DataBufferSize, SAL_Socket_DataBufferCache);
+
+#ifdef WINDOWS
+	AsyncLinkedList_Initialize(&reactor->Sockets, NULL);
+
+	memset(&reactor->WakeupAddress, 0, sizeof(reactor->WakeupAddress));
+	reactor->WakeupAddress.sin_family = AF_INET;
+	reactor->WakeupAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	reactor->WakeupAddress.sin_port = 0;
+	addressLength = sizeof(reactor->WakeupAddress);
+
+	reactor->Wakeup = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	bind(reactor->Wakeup, (struct sockaddr*)&reactor->WakeupAddress, addressLength);
+	getsockname(reactor->Wakeup, (struct sockaddr*)&reactor->WakeupAddress, &addressLength);
+
+	asyncEngine = SAL_Socket_Engines_Epoll;
+#elif defined POSIX
+	reactor->Epoll = epoll_create1(EPOLL_CLOEXEC);
+	reactor->Wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	reactor->RingWakePending = false;
+
+	event.events = EPOLLIN;
+	event.data.u64 = (uint64)reactor->Wakeup;
+	epoll_ctl(reactor->Epoll, EPOLL_CTL_ADD, reactor->Wakeup, &event);
+
+	/* readiness callbacks stay on epoll either way; the ring only carries operations, and its descriptor becomes readable when they complete */
+	reactor->Ring.Descriptor = -1;
+	reactor->RingBuffers.Ring = NULL;
+	if (asyncEngine == SAL_Socket_Engines_IOUring) {
+		if (!SAL_Ring_Initialize(&reactor->Ring, SAL_Socket_RingEntries))
+			return false;
+
+		if (!SAL_Socket_Reactor_ProbeRing(reactor)) {
+			SAL_Ring_Uninitialize(&reactor->Ring);
+			return false;
+		}
+
+		event.events = EPOLLIN;
+		event.data.u64 = (uint64)reactor->Ring.Descriptor;
+		epoll_ctl(reactor->Epoll, EPOLL_CTL_ADD, reactor->Ring.Descriptor, &event);
+
+		/* the kernel wants a power of two */
+		for (bufferCount = SAL_Socket_RingBufferCount; bufferCount > SAL_Socket_RingBufferMinimum && bufferCount > SAL_Socket_RingBufferCount / reactorCount; bufferCount /= 2)
+			;
+
+		/* without a provided buffer ring, multishot receives run on readiness instead */
+		if (SAL_Ring_RegisterBuffers(&reactor->Ring, &reactor->RingBuffers, SAL_Socket_RingBufferGroup, bufferCount, SAL_Socket_ReceiveBufferSize) && !SAL_Socket_Reactor_ProbeMultishot(reactor))
+			SAL_Ring_UnregisterBuffers(&reactor->Ring, &reactor->RingBuffers);
+	}
+#endif
+
+	return true;
+}
+
+#ifdef POSIX
+/* checks that the kernel can cancel all of a descriptor's operations at once, which closing a socket relies on; io_uring_setup succeeding says little about what the ring can do. cancelling by descriptor came with multishot accepts in Linux 5.19, and older kernels refuse it with EINVAL. */
+static boolean SAL_Socket_Reactor_ProbeRing(SAL_Socket_Reactor* reactor) {
+	struct io_uring_sqe* submission;
+	uint32 flags;
+	int32 result;
+
+	submission = SAL_Ring_GetSubmission(&reactor->Ring);
+	submission->opcode = IORING_OP_ASYNC_CANCEL;
+	submission->fd = reactor->Wakeup;
+	submission->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+
+	result = SAL_Socket_Reactor_RunProbe(reactor, &flags);
+
+	return result >= 0 || result == -ENOENT;
+}
+
+/* checks that the kernel has multishot receives, which came in Linux 6.0 and are all the provided buffer ring is used for. older kernels refuse them with EINVAL. */
+static boolean SAL_Socket_Reactor_ProbeMultishot(SAL_Socket_Reactor* reactor) {
+	struct io_uring_sqe* submission;
+	uint32 flags;
+	int32 result;
+	int pair[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0)
+		return false;
+
+	/* the peer is already gone, so the receive ends at once with the end of the stream rather than staying armed */
+	close(pair[1]);
+
+	submission = SAL_Ring_GetSubmission(&reactor->Ring);
+	submission->opcode = IORING_OP_RECV;
+	submission->ioprio = IORING_RECV_MULTISHOT;
+	submission->flags = IOSQE_BUFFER_SELECT;
+	submission->buf_group = SAL_Socket_RingBufferGroup;
+	submission->fd = pair[0];
+
+	result = SAL_Socket_Reactor_RunProbe(reactor, &flags);
+
+	if (flags & IORING_CQE_F_BUFFER)
+		SAL_Ring_ReturnBuffer(&reactor->RingBuffers, (uint16)(flags >> IORING_CQE_BUFFER_SHIFT));
+
+	close(pair[0]);
+
+	return result >= 0;
+}
+
+/* submits the one entry reserved on the ring of @a reactor, whose thread has not started, and waits for its completion. returns its result and stores its flags in @a flags. */
+static int32 SAL_Socket_Reactor_RunProbe(SAL_Socket_Reactor* reactor, uint32* flags) {
+	struct io_uring_cqe* completion;
+	int32 result;
+
+	result = SAL_Ring_Submit(&reactor->Ring, 1);
+	*flags = 0;
+
+	completion = SAL_Ring_PeekCompletion(&reactor->Ring);
+	if (result < 0 || completion == NULL)
+		return result < 0 ? result : -EINVAL;
+
+	result = completion->res;
+	*flags = completion->flags;
+
+	SAL_Ring_AdvanceCompletions(&reactor->Ring, 1);
+
+	return result;
+}
+#endif
+
+/* the reactor @a socket belongs to. Unless it was placed with @ref SAL_Socket_SetReactor, it is picked by descriptor, which spreads the connections accepted from one listener across the reactors without any shared counter. */
+static SAL_Socket_Reactor* SAL_Socket_Reactor_Of(SAL_Socket* socket) {
+	SAL_Socket_Reactor_InitializeAll();
+
+	if (socket->Reactor == SAL_Socket_Reactor_Unassigned)
+		socket->Reactor = (uint32)((uint64)socket->RawSocket % reactorCount);
+
+	return &reactors[socket->Reactor];
+}
+
+/* returns the index of the reactor to run work that belongs to no socket on: the calling reactor, or the next one in turn */
+static uint32 SAL_Socket_Reactor_Next() {
+	SAL_Socket_Reactor_InitializeAll();
+
+	if (currentReactor != NULL)
+		return currentReactor->Index;
+
+#ifdef WINDOWS
+	return (uint32)InterlockedIncrement((volatile LONG*)&nextReactor) % reactorCount;
+#elif defined POSIX
+	return __atomic_fetch_add(&nextReactor, 1, __ATOMIC_RELAXED) % reactorCount;
+#endif
+}
+
+/* starts the reactor's thread if it isn't running yet. It is never stopped: once idle it waits in the kernel, which costs nothing, rather than leaving a thread behind each time it goes idle and is started again. */
+static void SAL_Socket_Reactor_Start(SAL_Socket_Reactor* reactor) {
+	SAL_Mutex_Acquire(reactor->Lock);
+
+	if (!reactor->Alive) {
+		reactor->Alive = true;
+		reactor->Thread = SAL_Thread_Create(SAL_Socket_Reactor_Run, reactor);
+
+		if (reactor->Processor != SAL_Socket_Reactor_Unassigned)
+			SAL_Thread_SetAffinity(reactor->Thread, reactor->Processor);
+	}
+
+	SAL_Mutex_Release(reactor->Lock);
+}
+
+/* restricts the reactor's thread, and every thread it runs on later, to @a processor */
+static void SAL_Socket_Reactor_SetProcessor(SAL_Socket_Reactor* reactor, uint32 processor) {
+	SAL_Mutex_Acquire(reactor->Lock);
+
+	reactor->Processor = processor;
+	if (reactor->Alive)
+		SAL_Thread_SetAffinity(reactor->Thread, processor);
+
+	SAL_Mutex_Release(reactor->Lock);
+}
+
+/* interrupts the reactor's wait so it notices registration changes or a shutdown */
+static void SAL_Socket_Reactor_Wake(SAL_Socket_Reactor* reactor) {
+#ifdef WINDOWS
+	int8 wakeupData = 0;
+
+	sendto(reactor->Wakeup, &wakeupData, sizeof(wakeupData), 0, (struct sockaddr*)&reactor->WakeupAddress, sizeof(reactor->WakeupAddress));
+#elif defined POSIX
+	uint64 wakeupCount = 1;
+
+	write(reactor->Wakeup, &wakeupCount, sizeof(wakeupCount));
+#endif
+}
+
+/* brings the reactor's registration of @a socket in line with what is waiting on it: a read callback or pending operations. returns false if the socket could not be registered. */
+static boolean SAL_Socket_UpdateInterest(SAL_Socket* socket) {
+	SAL_Socket_Reactor* reactor;
+	uint8 interest;
+	uint8 previous;
+#ifdef POSIX
+	struct epoll_event event;
+#endif
+
+	interest = 0;
+	if (socket->Entry->ReadCallback != NULL || socket->Entry->DataCallback != NULL || socket->Entry->PendingRead != NULL)
+		interest |= SAL_Socket_Interest_Read;
+	if (socket->Entry->PendingWrite != NULL)
+		interest |= SAL_Socket_Interest_Write;
+	if (socket->Entry->ZeroCopyCallback != NULL)
+		interest |= SAL_Socket_Interest_Errors;
+
+	previous = socket->Entry->Interest;
+	if (interest == previous)
+		return true;
+
+	reactor = SAL_Socket_Reactor_Of(socket);
+
+	if (previous == 0 && !SAL_Socket_Table_Add(reactor, socket))
+		return false;
+
+	socket->Entry->Interest = interest;
+
+#ifdef WINDOWS
+	if (previous == 0)
+		AsyncLinkedList_Append(&reactor->Sockets, socket);
+	else if (interest == 0)
+		AsyncLinkedList_Remove(&reactor->Sockets, socket);
+#elif defined POSIX
+	event.events = ((interest & SAL_Socket_Interest_Read) ? EPOLLIN : 0) | ((interest & SAL_Socket_Interest_Write) ? EPOLLOUT : 0);
+	event.data.u64 = ((uint64)socket->Generation << 32) | (uint32)socket->RawSocket;
+	epoll_ctl(reactor->Epoll, previous == 0 ? EPOLL_CTL_ADD : (interest == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD), socket->RawSocket, &event);
+#endif
+
+	if (previous == 0) {
+		SAL_Socket_Reactor_Start(reactor);
+	}
+	else if (interest == 0) {
+		SAL_Socket_Table_Remove(reactor, socket);
+	}
+
+#ifdef WINDOWS
+	SAL_Socket_Reactor_Wake(reactor);
+#endif
+
+	return true;
+}
+
+static void SAL_Socket_SetBlocking(SAL_Socket* socket, boolean blocking) {
+#ifdef WINDOWS
+	u_long nonBlocking = blocking ? 0 : 1;
+
+	ioctlsocket((SOCKET)socket->RawSocket, FIONBIO, &nonBlocking);
+#elif defined POSIX
+	int flags;
+
+	flags = fcntl(socket->RawSocket, F_GETFL, 0);
+	fcntl(socket->RawSocket, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+#endif
+}
+
+/* windows can't be asked, so there a socket is taken to be blocking unless it was made non-blocking with SAL_Socket_SetNonBlocking */
+static boolean SAL_Socket_IsBlocking(SAL_Socket* socket) {
+#ifdef WINDOWS
+	return !socket->NonBlocking;
+#elif defined POSIX
+	return (fcntl(socket->RawSocket, F_GETFL, 0) & O_NONBLOCK) == 0;
+#endif
+}
+
+/* the status for a read or write on @a socket that failed with @a error, which is recorded as its last error unless it only means to try again later */
+static uint8 SAL_Socket_Fail(SAL_Socket* socket, int32 error) {
+#ifdef WINDOWS
+	if (error == WSAEWOULDBLOCK)
+		return SAL_Socket_Status_WouldBlock;
+
+	socket->LastError = (uint32)error;
+
+	if (error == WSAECONNRESET || error == WSAECONNABORTED || error == WSAESHUTDOWN)
+		return SAL_Socket_Status_Closed;
+#elif defined POSIX
+	if (error == EAGAIN || error == EWOULDBLOCK)
+		return SAL_Socket_Status_WouldBlock;
+
+	socket->LastError = (uint32)error;
+
+	if (error == ECONNRESET || error == EPIPE)
+		return SAL_Socket_Status_Closed;
+#endif
+
+	return SAL_Socket_Status_Error;
+}
+
+/* opens @a path for reading and gets its size */
+#ifdef WINDOWS
+static boolean SAL_Socket_OpenFile(const int8* const path, HANDLE* file, uint64* size) {
+	LARGE_INTEGER fileSize;
+
+	*file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (*file == INVALID_HANDLE_VALUE)
+		return false;
+
+	if (!GetFileSizeEx(*file, &fileSize)) {
+		CloseHandle(*file);
+		return false;
+	}
+
+	*size = (uint64)fileSize.QuadPart;
+
+	return true;
+}
+#elif defined POSIX
+static boolean SAL_Socket_OpenFile(const int8* const path, int* file, uint64* size) {
+	struct stat status;
+
+	*file = open(path, O_RDONLY | O_CLOEXEC);
+	if (*file == -1)
+		return false;
+
+	if (fstat(*file, &status) != 0) {
+		close(*file);
+		return false;
+	}
+
+	*size = (uint64)status.st_size;
+
+	return true;
+}
+#endif
+
+/* sends up to @a length bytes of @a file from *@a offset, at most SAL_Socket_SendFileChunk, and moves *@a offset past them. returns the number of bytes sent, 0 at the end of the file, or -1 with the error left in errno (WSAGetLastError under windows). */
+#ifdef WINDOWS
+static int32 SAL_Socket_TransmitFile(SAL_Socket* socket, HANDLE file, uint64* offset, uint64 length) {
+	LARGE_INTEGER position;
+	DWORD chunk;
+
+	chunk = (DWORD)(length < SAL_Socket_SendFileChunk ? length : SAL_Socket_SendFileChunk);
+
+	position.QuadPart = (LONGLONG)*offset;
+	if (!SetFilePointerEx(file, position, NULL, FILE_BEGIN))
+		return -1;
+
+	if (!TransmitFile((SOCKET)socket->RawSocket, file, chunk, 0, NULL, NULL, 0))
+		return -1;
+
+	*offset += chunk;
+
+	return (int32)chunk;
+}
+#elif defined POSIX
+static int32 SAL_Socket_TransmitFile(SAL_Socket* socket, int file, uint64* offset, uint64 length) {
+	off_t position;
+	ssize_t sent;
+
+	position = (off_t)*offset;
+	sent = sendfile(socket->RawSocket, file, &position, (size_t)(length < SAL_Socket_SendFileChunk ? length : SAL_Socket_SendFileChunk));
+	if (sent < 0)
+		return -1;
+
+	*offset = (uint64)position;
+
+	return (int32)sent;
+}
+#endif
+
+#ifdef POSIX
+/* reports the zero copy sends the kernel is done with, as found in the error queue of @a socket */
+static void SAL_Socket_ReceiveNotifications(SAL_Socket* socket) {
+	struct msghdr message;
+	struct cmsghdr* header;
+	struct sock_extended_err* error;
+	uint8 control[128];
+	boolean received;
+	int32 pending;
+	socklen_t pendingLength;
+
+	received = false;
+
+	while (true) {
+		memset(&message, 0, sizeof(message));
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		if (recvmsg(socket->RawSocket, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		received = true;
+
+		for (header = CMSG_FIRSTHDR(&message); header != NULL; header = CMSG_NXTHDR(&message, header)) {
+			if (!((header->cmsg_level == SOL_IP && header->cmsg_type == IP_RECVERR) || (header->cmsg_level == SOL_IPV6 && header->cmsg_type == IPV6_RECVERR)))
+				continue;
+
+			error = (struct sock_extended_err*)CMSG_DATA(header);
+			if (error->ee_errno != 0 || error->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+				continue;
+
+			/* a range of sends, inclusive; copied means the kernel fell back to copying them, which makes zero copy a loss for this socket */
+			socket->Entry->ZeroCopyCallback(socket, error->ee_info, error->ee_data, (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0, socket->ZeroCopyCallbackState);
+
+			if (socket->Entry->ZeroCopyCallback == NULL) /* unset, or closed, by the callback */
+				return;
+		}
+	}
+
+	/* the error was a real one rather than a notification. Nothing but the error queue is watched, so it is taken off the socket here; otherwise it would be reported again on every round. */
+	if (!received && socket->Entry->Interest == SAL_Socket_Interest_Errors) {
+		pendingLength = sizeof(pending);
+		getsockopt(socket->RawSocket, SOL_SOCKET, SO_ERROR, &pending, &pendingLength);
+	}
+}
+#endif
+
+/* moves *@a vectors past the first @a sent bytes, trimming the vector that was only partly sent. returns how many vectors are left. */
+static uint32 SAL_Socket_AdvanceVectors(SAL_Socket_IOVector** vectors, uint32 count, uint32 sent) {
+	while (count > 0 && sent >= (*vectors)->Length) {
+		sent -= (uint32)(*vectors)->Length;
+		(*vectors)++;
+		count--;
+	}
+
+	if (count > 0) {
+		(*vectors)->Buffer += sent;
+		(*vectors)->Length -= sent;
+	}
+
+	return count;
+}
+
+/* creates an operation and counts it against its socket and the socket's reactor, which stays up until every operation has completed */
+static SAL_Socket_Operation* SAL_Socket_Operation_Begin(SAL_Socket* socket, uint8 type, void* const state) {
+	SAL_Socket_Reactor* reactor;
+	SAL_Socket_Operation* operation;
+
+	reactor = SAL_Socket_Reactor_Of(socket);
+
+	operation = Allocate(SAL_Socket_Operation);
+	operation->Socket = socket;
+	operation->Type = type;
+	operation->Buffer = NULL;
+	operation->Length = 0;
+	operation->Done = 0;
+	operation->AddressInfo = NULL;
+	operation->RemoteAddress.ss_family = AF_UNSPEC;
+	operation->RemoteAddressLength = sizeof(operation->RemoteAddress);
+	#ifdef WINDOWS
+		operation->File = INVALID_HANDLE_VALUE;
+	#elif defined POSIX
+		operation->File = -1;
+	#endif
+	operation->FileOffset = 0;
+	operation->FileRemaining = 0;
+	operation->RestoreBlocking = false;
+	operation->Reader = NULL;
+	#ifdef POSIX
+		operation->Relay = NULL;
+		operation->Destination = NULL;
+		operation->Pipe[0] = -1;
+		operation->Pipe[1] = -1;
+		operation->PipeSize = 0;
+		operation->Buffered = 0;
+		operation->SourceDone = false;
+	#endif
+	operation->CompletionCallback = NULL;
+	operation->AcceptCallback = NULL;
+	operation->ConnectCallback = NULL;
+	operation->ReceiveCallback = NULL;
+	operation->State = state;
+	operation->Readiness = false;
+
+	SAL_Mutex_Acquire(reactor->OperationLock);
+	socket->Operations++;
+	reactor->Operations++;
+	SAL_Mutex_Release(reactor->OperationLock);
+
+	SAL_Socket_Reactor_Start(reactor);
+
+	return operation;
+}
+
+/* undoes the accounting of SAL_Socket_Operation_Begin. The last operation on a socket that was closed while they were in flight finishes closing it. */
+static void SAL_Socket_Operation_End(SAL_Socket_Operation* operation) {
+	SAL_Socket_Reactor* reactor;
+	SAL_Socket* socket;
+	boolean finishClose;
+
+	socket = operation->Socket;
+	reactor = SAL_Socket_Reactor_Of(socket);
+
+	SAL_Mutex_Acquire(reactor->OperationLock);
+	socket->Operations--;
+	reactor->Operations--;
+	finishClose = socket->Entry->Closing && socket->Operations == 0;
+	SAL_Mutex_Release(reactor->OperationLock);
+
+	if (finishClose)
+		SAL_Socket_Free(socket);
+}
+
+/* hands @a operation to the engine: queued on its reactor's ring, or parked on its socket until the reactor sees it ready */
+static boolean SAL_Socket_Operation_Submit(SAL_Socket_Operation* operation) {
+	SAL_Socket* socket;
+#ifdef POSIX
+	SAL_Socket_Reactor* reactor;
+	struct io_uring_sqe* submission;
+	boolean wake;
+#endif
+
+	socket = operation->Socket;
+
+#ifdef POSIX
+	if (asyncEngine == SAL_Socket_Engines_IOUring && !operation->Readiness) {
+		reactor = SAL_Socket_Reactor_Of(socket);
+
+		SAL_Mutex_Acquire(reactor->OperationLock);
+
+		submission = SAL_Ring_GetSubmission(&reactor->Ring);
+		if (submission == NULL) {
+			/* the queue is full; flush it early rather than fail */
+			SAL_Ring_Submit(&reactor->Ring, 0);
+			submission = SAL_Ring_GetSubmission(&reactor->Ring);
+		}
+
+		if (submission == NULL) {
+			SAL_Mutex_Release(reactor->OperationLock);
+			return false;
+		}
+
+		submission->fd = socket->RawSocket;
+		submission->user_data = (uint64)(size_t)operation;
+
+		switch (operation->Type) {
+			case SAL_Socket_Operations_Read:
+				submission->opcode = IORING_OP_RECV;
+				submission->addr = (uint64)(size_t)operation->Buffer;
+				submission->len = operation->Length;
+				break;
+
+			case SAL_Socket_Operations_Write:
+				submission->opcode = IORING_OP_SEND;
+				submission->addr = (uint64)(size_t)(operation->Buffer + operation->Done);
+				submission->len = operation->Length - operation->Done;
+				submission->msg_flags = MSG_NOSIGNAL;
+				break;
+
+			case SAL_Socket_Operations_Accept:
+				submission->opcode = IORING_OP_ACCEPT;
+				submission->addr = (uint64)(size_t)&operation->RemoteAddress;
+				submission->addr2 = (uint64)(size_t)&operation->RemoteAddressLength;
+				submission->accept_flags = SOCK_CLOEXEC;
+				break;
+
+			case SAL_Socket_Operations_Connect:
+				submission->opcode = IORING_OP_CONNECT;
+				submission->addr = (uint64)(size_t)operation->AddressInfo->ai_addr;
+				submission->off = operation->AddressInfo->ai_addrlen;
+				break;
+
+			case SAL_Socket_Operations_AcceptMultishot:
+				submission->opcode = IORING_OP_ACCEPT;
+				submission->ioprio = IORING_ACCEPT_MULTISHOT;
+				submission->accept_flags = SOCK_CLOEXEC;
+				break;
+
+			case SAL_Socket_Operations_ReceiveMultishot:
+				submission->opcode = IORING_OP_RECV;
+				submission->ioprio = IORING_RECV_MULTISHOT;
+				submission->flags = IOSQE_BUFFER_SELECT;
+				submission->buf_group = SAL_Socket_RingBufferGroup;
+				break;
+		}
+
+		/* the reactor submits at the top of every round, so only a submission from another thread needs to wake it */
+		wake = currentReactor != reactor && !reactor->RingWakePending;
+		if (wake)
+			reactor->RingWakePending = true;
+
+		SAL_Mutex_Release(reactor->OperationLock);
+
+		if (wake)
+			SAL_Socket_Reactor_Wake(reactor);
+
+		return true;
+	}
+#endif
+
+	/* a multishot accept drains the backlog each time the listener is ready, which needs it not to block once it is empty */
+	if (operation->Type == SAL_Socket_Operations_AcceptMultishot)
+		SAL_Socket_SetBlocking(socket, false);
+
+	if (operation->Type == SAL_Socket_Operations_Write || operation->Type == SAL_Socket_Operations_Connect || operation->Type == SAL_Socket_Operations_SendFile || operation->Type == SAL_Socket_Operations_Flush)
+		socket->Entry->PendingWrite = operation;
+	else
+		socket->Entry->PendingRead = operation;
+
+	if (!SAL_Socket_UpdateInterest(socket)) {
+		socket->Entry->PendingRead = operation == socket->Entry->PendingRead ? NULL : socket->Entry->PendingRead;
+		socket->Entry->PendingWrite = operation == socket->Entry->PendingWrite ? NULL : socket->Entry->PendingWrite;
+		return false;
+	}
+
+	return true;
+}
+
+/* on the epoll engine, attempts a pending operation now that its socket is ready, completing it unless it would still block */
+static void SAL_Socket_Operation_Perform(SAL_Socket_Operation* operation) {
+	SAL_Socket* socket;
+	int32 result;
+	int32 error;
+#ifdef WINDOWS
+	int errorLength;
+#elif defined POSIX
+	socklen_t errorLength;
+#endif
+
+	socket = operation->Socket;
+
+#ifdef POSIX
+	if (operation->Type == SAL_Socket_Operations_Relay) {
+		SAL_Socket_Relay_Pump(operation);
+		return;
+	}
+#endif
+
+	if (operation->Type == SAL_Socket_Operations_Flush) {
+		SAL_Socket_WriteQueue_Flush(operation);
+		return;
+	}
+
+	if (operation->Type == SAL_Socket_Operations_ReceiveFrames) {
+		SAL_Socket_Operation_PerformFrames(operation);
+		return;
+	}
+
+	switch (operation->Type) {
+		case SAL_Socket_Operations_Read:
+			#ifdef WINDOWS
+				result = recv((SOCKET)socket->RawSocket, (int8*)operation->Buffer, operation->Length, 0);
+			#elif defined POSIX
+				result = recv(socket->RawSocket, operation->Buffer, operation->Length, MSG_DONTWAIT);
+			#endif
+			break;
+
+		case SAL_Socket_Operations_Write:
+			#ifdef WINDOWS
+				result = send((SOCKET)socket->RawSocket, (const int8*)(operation->Buffer + operation->Done), operation->Length - operation->Done, 0);
+			#elif defined POSIX
+				result = send(socket->RawSocket, operation->Buffer + operation->Done, operation->Length - operation->Done, MSG_DONTWAIT | MSG_NOSIGNAL);
+			#endif
+			break;
+
+		case SAL_Socket_Operations_Accept:
+			#ifdef WINDOWS
+				result = (int32)accept((SOCKET)socket->RawSocket, (struct sockaddr*)&operation->RemoteAddress, &operation->RemoteAddressLength);
+			#elif defined POSIX
+				result = accept4(socket->RawSocket, (struct sockaddr*)&operation->RemoteAddress, &operation->RemoteAddressLength, SOCK_CLOEXEC);
+			#endif
+			break;
+
+		case SAL_Socket_Operations_Connect:
+			error = 0;
+			errorLength = sizeof(error);
+			getsockopt(socket->RawSocket, SOL_SOCKET, SO_ERROR, (int8*)&error, &errorLength);
+			result = 0;
+			break;
+
+		/* sends until the socket would block or the file is done, staying parked in between */
+		case SAL_Socket_Operations_SendFile:
+			do {
+				result = SAL_Socket_TransmitFile(socket, operation->File, &operation->FileOffset, operation->FileRemaining);
+				if (result > 0)
+					operation->FileRemaining -= (uint32)result;
+			} while (result > 0 && operation->FileRemaining > 0);
+
+			/* a file that got shorter since it was opened just ends the transfer early */
+			if (result >= 0)
+				result = 0;
+			break;
+
+		/* every other type is performed before the switch; one that gets here fails rather than completing with garbage */
+		default:
+			assert(false);
+			#ifdef WINDOWS
+				WSASetLastError(WSAEINVAL);
+			#elif defined POSIX
+				errno = EINVAL;
+			#endif
+			result = -1;
+			break;
+	}
+
+#ifdef WINDOWS
+	if (operation->Type == SAL_Socket_Operations_Connect) {
+		result = -error;
+	}
+	else if (result < 0) {
+		if (WSAGetLastError() == WSAEWOULDBLOCK)
+			return;
+		result = -WSAGetLastError();
+	}
+#elif defined POSIX
+	if (operation->Type == SAL_Socket_Operations_Connect) {
+		result = -error;
+	}
+	else if (result < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return;
+		result = -errno;
+	}
+#endif
+
+	if (operation == socket->Entry->PendingRead)
+		socket->Entry->PendingRead = NULL;
+	else
+		socket->Entry->PendingWrite = NULL;
+
+	SAL_Socket_UpdateInterest(socket);
+	SAL_Socket_Operation_Complete(operation, result);
+}
+
+/* on the epoll engine, runs a multishot operation for as long as its socket stays ready. The operation stays parked until it fails or the peer closes the connection. */
+static void SAL_Socket_Operation_PerformMultishot(SAL_Socket_Operation* operation) {
+	SAL_Socket_Reactor* reactor;
+	SAL_Socket* socket;
+	SAL_Socket* accepted;
+	struct sockaddr_storage remoteAddress;
+	uint64 descriptor;
+	uint32 generation;
+	int32 result;
+	int32 error;
+#ifdef WINDOWS
+	int addressLength;
+#elif defined POSIX
+	socklen_t addressLength;
+#endif
+
+	socket = operation->Socket;
+	reactor = SAL_Socket_Reactor_Of(socket);
+	descriptor = (uint64)socket->RawSocket;
+	generation = socket->Generation;
+
+	while (true) {
+		if (operation->Type == SAL_Socket_Operations_AcceptMultishot) {
+			addressLength = sizeof(remoteAddress);
+			#ifdef WINDOWS
+				result = (int32)accept((SOCKET)socket->RawSocket, (struct sockaddr*)&remoteAddress, &addressLength);
+			#elif defined POSIX
+				result = accept4(socket->RawSocket, (struct sockaddr*)&remoteAddress, &addressLength, SOCK_CLOEXEC);
+			#endif
+		}
+		else {
+			/* every connection on the reactor shares its buffer; nothing is held for a connection between reads */
+			#ifdef WINDOWS
+				result = recv((SOCKET)socket->RawSocket, (int8*)reactor->ReceiveBuffer, sizeof(reactor->ReceiveBuffer), 0);
+			#elif defined POSIX
+				result = recv(socket->RawSocket, reactor->ReceiveBuffer, sizeof(reactor->ReceiveBuffer), MSG_DONTWAIT);
+			#endif
+		}
+
+		#ifdef WINDOWS
+			error = result < 0 ? WSAGetLastError() : 0;
+			if (error == WSAEWOULDBLOCK)
+				return;
+			result = result < 0 ? -error : result;
+		#elif defined POSIX
+			error = result < 0 ? errno : 0;
+			if (error == EAGAIN || error == EWOULDBLOCK)
+				return;
+			if (error == EINTR)
+				continue;
+			result = result < 0 ? -error : result;
+		#endif
+
+		if (operation->Type == SAL_Socket_Operations_AcceptMultishot && result >= 0) {
+			accepted = SAL_Socket_NewAccepted(socket, (uint64)result, (struct sockaddr*)&remoteAddress);
+
+			operation->AcceptCallback(socket, accepted, operation->State);
+		}
+		else if (operation->Type == SAL_Socket_Operations_ReceiveMultishot && result > 0) {
+			operation->ReceiveCallback(socket, reactor->ReceiveBuffer, (uint32)result, operation->State);
+
+			/* a short read means the socket has been drained */
+			if ((uint32)result < sizeof(reactor->ReceiveBuffer) && SAL_Socket_Table_Find(reactor, descriptor, generation) == socket && socket->Entry->PendingRead == operation)
+				return;
+		}
+		else {
+			socket->Entry->PendingRead = NULL;
+			SAL_Socket_UpdateInterest(socket);
+			SAL_Socket_Operation_Complete(operation, result);
+			return;
+		}
+
+		/* the callback may have closed the socket, which frees a parked operation */
+		if (SAL_Socket_Table_Find(reactor, descriptor, generation) != socket || socket->Entry->PendingRead != operation)
+			return;
+	}
+}
+
+/* runs a framed receive: reads what has arrived into the operation's reader and hands every complete frame to the callback, straight from the reader's buffer. The operation stays parked until the connection ends or the data breaks the framing. */
+static void SAL_Socket_Operation_PerformFrames(SAL_Socket_Operation* operation) {
+	SAL_Socket_Reactor* reactor;
+	SAL_Socket* socket;
+	const uint8* frame;
+	uint8* space;
+	uint64 descriptor;
+	uint32 generation;
+	uint32 available;
+	uint32 length;
+	int32 result;
+	int8 status;
+
+	socket = operation->Socket;
+	reactor = SAL_Socket_Reactor_Of(socket);
+	descriptor = (uint64)socket->RawSocket;
+	generation = socket->Generation;
+
+	while (true) {
+		space = SAL_Frame_Reader_GetSpace(operation->Reader, &available);
+
+		#ifdef WINDOWS
+			result = recv((SOCKET)socket->RawSocket, (int8*)space, available, 0);
+			if (result < 0 && WSAGetLastError() == WSAEWOULDBLOCK)
+				return;
+		#elif defined POSIX
+			result = recv(socket->RawSocket, space, available, MSG_DONTWAIT);
+			if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+				return;
+			if (result < 0 && errno == EINTR)
+				continue;
+		#endif
+
+		if (result <= 0)
+			break;
+
+		SAL_Frame_Reader_Commit(operation->Reader, (uint32)result);
+
+		while ((status = SAL_Frame_Reader_Next(operation->Reader, &frame, &length)) == SAL_Frame_Result_Frame) {
+			operation->ReceiveCallback(socket, frame, length, operation->State);
+
+			/* the callback may have closed the socket, which frees a parked operation */
+			if (SAL_Socket_Table_Find(reactor, descriptor, generation) != socket || socket->Entry->PendingRead != operation)
+				return;
+		}
+
+		if (status != SAL_Frame_Result_Incomplete)
+			break;
+
+		/* a short read means the socket has been drained */
+		if ((uint32)result < available)
+			return;
+	}
+
+	socket->Entry->PendingRead = NULL;
+	SAL_Socket_UpdateInterest(socket);
+	SAL_Socket_Operation_Complete(operation, result);
+}
+
+#ifdef POSIX
+/* handles a completion from the ring. Multishot operations produce many; everything else finishes on its first. */
+static void SAL_Socket_Operation_Deliver(SAL_Socket_Operation* operation, int32 result, uint32 flags) {
+	SAL_Socket_Reactor* reactor;
+	SAL_Socket* socket;
+	SAL_Socket* accepted;
+	struct sockaddr_storage remoteAddress;
+	socklen_t addressLength;
+	uint16 buffer;
+
+	socket = operation->Socket;
+	reactor = SAL_Socket_Reactor_Of(socket);
+
+	if (operation->Type == SAL_Socket_Operations_AcceptMultishot) {
+		if (result >= 0) {
+			if (socket->Entry->Closing) {
+				close(result);
+			}
+			else {
+				/* the completions of a multishot accept carry no address, so it is asked for */
+				remoteAddress.ss_family = AF_UNSPEC;
+				addressLength = sizeof(remoteAddress);
+				getpeername(result, (struct sockaddr*)&remoteAddress, &addressLength);
+
+				accepted = SAL_Socket_NewAccepted(socket, (uint64)result, (struct sockaddr*)&remoteAddress);
+
+				operation->AcceptCallback(socket, accepted, operation->State);
+			}
+		}
+	}
+	else if (operation->Type == SAL_Socket_Operations_ReceiveMultishot) {
+		if (flags & IORING_CQE_F_BUFFER) {
+			buffer = (uint16)(flags >> IORING_CQE_BUFFER_SHIFT);
+
+			if (result > 0 && !socket->Entry->Closing)
+				operation->ReceiveCallback(socket, SAL_Ring_GetBuffer(&reactor->RingBuffers, buffer), (uint32)result, operation->State);
+
+			SAL_Mutex_Acquire(reactor->OperationLock);
+			SAL_Ring_ReturnBuffer(&reactor->RingBuffers, buffer);
+			SAL_Mutex_Release(reactor->OperationLock);
+		}
+	}
+	else {
+		SAL_Socket_Operation_Complete(operation, result);
+		return;
+	}
+
+	if (flags & IORING_CQE_F_MORE)
+		return;
+
+	/* the kernel ended the multishot operation. It is rearmed if it only stopped because it was overrun (a full completion queue, or no free buffers), and moved onto readiness if the kernel turned it down. */
+	if (!socket->Entry->Closing) {
+		if ((result >= 0 && !(operation->Type == SAL_Socket_Operations_ReceiveMultishot && result == 0)) || result == -ENOBUFS) {
+			if (SAL_Socket_Operation_Submit(operation))
+				return;
+		}
+		else if (result == -EINVAL && !operation->Readiness) {
+			operation->Readiness = true;
+			if (SAL_Socket_Operation_Submit(operation))
+				return;
+		}
+	}
+
+	SAL_Socket_Operation_Complete(operation, result > 0 ? 0 : result);
+}
+#endif
+
+/* finishes @a operation with @a result (a byte count, a descriptor or a negated error code, as io_uring reports it) and runs its callback */
+static void SAL_Socket_Operation_Complete(SAL_Socket_Operation* operation, int32 result) {
+	SAL_Socket* socket;
+	SAL_Socket* accepted;
+
+	socket = operation->Socket;
+
+	/* a write is only done once all of it has gone out */
+	if (operation->Type == SAL_Socket_Operations_Write && result > 0 && !socket->Entry->Closing) {
+		operation->Done += (uint32)result;
+
+		if (operation->Done < operation->Length && SAL_Socket_Operation_Submit(operation))
+			return;
+
+		result = (int32)operation->Done;
+	}
+
+	SAL_Socket_Operation_Release(operation);
+
+	if (operation->RestoreBlocking && !socket->Entry->Closing)
+		SAL_Socket_SetBlocking(socket, true);
+
+	if (socket->Entry->Closing) {
+		if (operation->Type == SAL_Socket_Operations_Accept && result >= 0) {
+			#ifdef WINDOWS
+				closesocket((SOCKET)result);
+			#elif defined POSIX
+				close(result);
+			#endif
+		}
+
+		SAL_Socket_Operation_End(operation);
+		Free(operation);
+
+		return;
+	}
+
+	/* ended first so that the callback is free to close the socket */
+	SAL_Socket_Operation_End(operation);
+
+	switch (operation->Type) {
+		case SAL_Socket_Operations_Read:
+		case SAL_Socket_Operations_Write:
+		case SAL_Socket_Operations_SendFile:
+			operation->CompletionCallback(socket, result, operation->State);
+			break;
+
+		case SAL_Socket_Operations_Accept:
+			accepted = NULL;
+			if (result >= 0) {
+				accepted = SAL_Socket_NewAccepted(socket, (uint64)result, (struct sockaddr*)&operation->RemoteAddress);
+			}
+
+			operation->AcceptCallback(socket, accepted, operation->State);
+			break;
+
+		case SAL_Socket_Operations_Connect:
+			if (result == 0) {
+				SAL_Socket_SetBlocking(socket, true);
+				socket->Connected = true;
+				operation->ConnectCallback(socket, operation->State);
+			}
+			else {
+				SAL_Socket_Close(socket);
+				operation->ConnectCallback(NULL, operation->State);
+			}
+			break;
+
+		/* a multishot operation only finishes when it fails or the connection ends */
+		case SAL_Socket_Operations_AcceptMultishot:
+			operation->AcceptCallback(socket, NULL, operation->State);
+			break;
+
+		case SAL_Socket_Operations_ReceiveMultishot:
+		case SAL_Socket_Operations_ReceiveFrames:
+			operation->ReceiveCallback(socket, NULL, 0, operation->State);
+			break;
+	}
+
+	Free(operation);
+}
+
+/* drops the operations of a socket that is being closed. Parked operations are freed without their callbacks; operations in flight on the ring are cancelled and the socket is freed by the last of them. returns true in that case, after which the caller must not touch the socket. */
+static boolean SAL_Socket_Operation_CancelAll(SAL_Socket* socket) {
+	SAL_Socket_Operation* operation;
+#ifdef POSIX
+	SAL_Socket_Reactor* reactor;
+	struct io_uring_sqe* submission;
+	boolean closing;
+#endif
+
+	while (socket->Entry->PendingRead != NULL || socket->Entry->PendingWrite != NULL) {
+		operation = socket->Entry->PendingRead != NULL ? socket->Entry->PendingRead : socket->Entry->PendingWrite;
+
+		if (operation == socket->Entry->PendingRead)
+			socket->Entry->PendingRead = NULL;
+		else
+			socket->Entry->PendingWrite = NULL;
+
+		/* both directions of a relay go through the socket, so the whole relay ends, without its callback */
+		#ifdef POSIX
+			if (operation->Type == SAL_Socket_Operations_Relay) {
+				operation->Relay->Callback = NULL;
+				SAL_Socket_Relay_Finish(operation, -ECANCELED);
+				continue;
+			}
+		#endif
+
+		SAL_Socket_Operation_Release(operation);
+		SAL_Socket_Operation_End(operation);
+		Free(operation);
+	}
+
+	SAL_Socket_UpdateInterest(socket);
+
+#ifdef POSIX
+	/* a socket that was never given to a reactor has nothing in flight */
+	if (asyncEngine == SAL_Socket_Engines_IOUring && socket->Reactor != SAL_Socket_Reactor_Unassigned) {
+		reactor = SAL_Socket_Reactor_Of(socket);
+
+		SAL_Mutex_Acquire(reactor->OperationLock);
+
+		closing = socket->Operations > 0;
+		if (closing) {
+			socket->Entry->Closing = true;
+
+			submission = SAL_Ring_GetSubmission(&reactor->Ring);
+			if (submission != NULL) {
+				submission->opcode = IORING_OP_ASYNC_CANCEL;
+				submission->fd = socket->RawSocket;
+				submission->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+				submission->user_data = 0;
+			}
+
+			SAL_Ring_Submit(&reactor->Ring, 0);
+		}
+
+		SAL_Mutex_Release(reactor->OperationLock);
+
+		return closing;
+	}
+#endif
+
+	return false;
+}
+
+/* frees what @a operation holds besides itself: the resolved address of a connect, the file of a transfer, the reader of a framed receive or the pipe of a relay */
+static void SAL_Socket_Operation_Release(SAL_Socket_Operation* operation) {
+	if (operation->AddressInfo != NULL) {
+		SAL_Socket_Addresses_Free(operation->AddressInfo);
+		operation->AddressInfo = NULL;
+	}
+
+	if (operation->Reader != NULL) {
+		SAL_Frame_Reader_Uninitialize(operation->Reader);
+		Free(operation->Reader);
+		operation->Reader = NULL;
+	}
+
+#ifdef WINDOWS
+	if (operation->File != INVALID_HANDLE_VALUE) {
+		CloseHandle(operation->File);
+		operation->File = INVALID_HANDLE_VALUE;
+	}
+#elif defined POSIX
+	if (operation->File != -1) {
+		close(operation->File);
+		operation->File = -1;
+	}
+
+	if (operation->Pipe[0] != -1) {
+		close(operation->Pipe[0]);
+		close(operation->Pipe[1]);
+		operation->Pipe[0] = -1;
+		operation->Pipe[1] = -1;
+	}
+#endif
+}
+
+#ifdef POSIX
+/* moves what it can of one direction of a relay: from the source into the pipe while the pipe has room, and from the pipe into the destination while it takes it. The source is only watched while the pipe has room, which holds a fast sender back to the pace of a slow receiver. */
+static void SAL_Socket_Relay_Pump(SAL_Socket_Operation* operation) {
+	SAL_Socket_RelayState* relay;
+	SAL_Socket* source;
+	SAL_Socket* destination;
+	ssize_t moved;
+	boolean progress;
+	boolean finished;
+	int32 result;
+
+	relay = operation->Relay;
+	source = operation->Socket;
+	destination = operation->Destination;
+	result = 0;
+
+	SAL_Mutex_Acquire(relay->Lock);
+
+	do {
+		progress = false;
+
+		if (!operation->SourceDone && operation->Buffered < operation->PipeSize) {
+			moved = splice(source->RawSocket, NULL, operation->Pipe[1], NULL, operation->PipeSize - operation->Buffered, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if (moved > 0) {
+				operation->Buffered += (uint32)moved;
+				progress = true;
+			}
+			else if (moved == 0) {
+				operation->SourceDone = true;
+			}
+			else if (errno != EAGAIN && errno != EINTR) {
+				result = -errno;
+				break;
+			}
+		}
+
+		if (operation->Buffered > 0) {
+			moved = splice(operation->Pipe[0], NULL, destination->RawSocket, NULL, operation->Buffered, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if (moved > 0) {
+				operation->Buffered -= (uint32)moved;
+				relay->Counts[relay->Directions[0] == operation ? 0 : 1] += (uint64)moved;
+				progress = true;
+			}
+			else if (moved < 0 && errno != EAGAIN && errno != EINTR) {
+				result = -errno;
+				break;
+			}
+		}
+	} while (progress);
+
+	finished = result < 0 || (operation->SourceDone && operation->Buffered == 0);
+
+	if (!finished) {
+		source->Entry->PendingRead = !operation->SourceDone && operation->Buffered < operation->PipeSize ? operation : NULL;
+		destination->Entry->PendingWrite = operation->Buffered > 0 ? operation : NULL;
+
+		SAL_Socket_UpdateInterest(source);
+		SAL_Socket_UpdateInterest(destination);
+	}
+	else if (result == 0) {
+		/* the source has finished sending; pass the half-close on and leave the other direction running */
+		shutdown(destination->RawSocket, SHUT_WR);
+	}
+
+	SAL_Mutex_Release(relay->Lock);
+
+	if (finished)
+		SAL_Socket_Relay_Finish(operation, result);
+}
+
+/* ends one direction of a relay. A failure ends the other direction as well, and once neither is left the callback gets the totals. */
+static void SAL_Socket_Relay_Finish(SAL_Socket_Operation* operation, int32 result) {
+	SAL_Socket_RelayState* relay;
+	SAL_Socket* source;
+	SAL_Socket* destination;
+	uint32 direction;
+
+	relay = operation->Relay;
+	source = operation->Socket;
+	destination = operation->Destination;
+	direction = relay->Directions[0] == operation ? 0 : 1;
+
+	if (source->Entry->PendingRead == operation)
+		source->Entry->PendingRead = NULL;
+	if (destination->Entry->PendingWrite == operation)
+		destination->Entry->PendingWrite = NULL;
+
+	SAL_Socket_UpdateInterest(source);
+	SAL_Socket_UpdateInterest(destination);
+
+	if (result < 0 && relay->Result == 0)
+		relay->Result = result;
+
+	relay->Directions[direction] = NULL;
+
+	SAL_Socket_Operation_Release(operation);
+	SAL_Socket_Operation_End(operation);
+	Free(operation);
+
+	if (result < 0 && relay->Directions[1 - direction] != NULL) {
+		SAL_Socket_Relay_Finish(relay->Directions[1 - direction], result);
+		return;
+	}
+
+	if (relay->Directions[0] == NULL && relay->Directions[1] == NULL) {
+		if (relay->Callback != NULL)
+			relay->Callback(relay->Sockets[0], relay->Sockets[1], relay->Counts[0], relay->Counts[1], relay->Result, relay->State);
+
+		SAL_Mutex_Free(relay->Lock);
+		Free(relay);
+	}
+}
+#endif
+
+/* returns the write queue of @a socket, creating it with the default limits on first use */
+static SAL_Socket_WriteQueue* SAL_Socket_WriteQueue_Get(SAL_Socket* socket) {
+	SAL_Socket_WriteQueue* queue;
+
+	if (socket->WriteQueue != NULL)
+		return socket->WriteQueue;
+
+	queue = Allocate(SAL_Socket_WriteQueue);
+	queue->Lock = SAL_Mutex_Create();
+	queue->Head = NULL;
+	queue->Tail = NULL;
+	queue->Queued = 0;
+	queue->HighWatermark = SAL_Socket_WriteQueueHighWatermark;
+	queue->LowWatermark = SAL_Socket_WriteQueueLowWatermark;
+	queue->Full = false;
+	queue->Error = 0;
+	queue->Operation = NULL;
+	queue->DrainCallback = NULL;
+	queue->DrainCallbackState = NULL;
+	queue->Drained = SAL_Semaphore_Create();
+	queue->DrainWaiters = 0;
+	queue->Corked = false;
+	queue->AutoFlush = false;
+	queue->NextCorked = NULL;
+
+	socket->WriteQueue = queue;
+
+	return queue;
+}
+
+/* copies @a length bytes onto the end of @a queue, filling up its last block before starting a new one */
+static void SAL_Socket_WriteQueue_Append(SAL_Socket_WriteQueue* queue, const uint8* data, uint32 length) {
+	SAL_Socket_QueuedWrite* block;
+	uint32 amount;
+
+	queue->Queued += length;
+
+	if (queue->Tail != NULL && queue->Tail->End < queue->Tail->Capacity) {
+		amount = queue->Tail->Capacity - queue->Tail->End;
+		if (amount > length)
+			amount = length;
+
+		memcpy(queue->Tail->Data + queue->Tail->End, data, amount);
+		queue->Tail->End += amount;
+		data += amount;
+		length -= amount;
+	}
+
+	if (length == 0)
+		return;
+
+	block = Allocate(SAL_Socket_QueuedWrite);
+	block->Next = NULL;
+	block->Capacity = length > SAL_Socket_WriteQueueBlockSize ? length : SAL_Socket_WriteQueueBlockSize;
+	block->Data = AllocateArray(uint8, block->Capacity);
+	block->Start = 0;
+	block->End = length;
+	memcpy(block->Data, data, length);
+
+	if (queue->Tail != NULL)
+		queue->Tail->Next = block;
+	else
+		queue->Head = block;
+
+	queue->Tail = block;
+}
+
+/* drops everything in @a queue */
+static void SAL_Socket_WriteQueue_Discard(SAL_Socket_WriteQueue* queue) {
+	SAL_Socket_QueuedWrite* block;
+
+	while ((block = queue->Head) != NULL) {
+		queue->Head = block->Next;
+		Free(block->Data);
+		Free(block);
+	}
+
+	queue->Tail = NULL;
+	queue->Queued = 0;
+}
+
+/* sends what the socket takes of @a queue, several blocks per call, until it is empty or the socket would block. A batch with more queued behind it is sent with MSG_MORE, so that the kernel holds a partial segment back for the next one. returns 0, or a negated error code if sending failed. */
+static int32 SAL_Socket_WriteQueue_Send(SAL_Socket* socket, SAL_Socket_WriteQueue* queue) {
+	SAL_Socket_QueuedWrite* block;
+	SAL_Socket_IOVector vectors[SAL_Socket_WriteQueueMaxVectors];
+	uint32 count;
+	uint32 sent;
+#ifdef WINDOWS
+	DWORD written;
+#elif defined POSIX
+	struct msghdr message;
+	ssize_t written;
+#endif
+
+	while (queue->Head != NULL) {
+		for (count = 0, block = queue->Head; count < SAL_Socket_WriteQueueMaxVectors && block != NULL; count++, block = block->Next) {
+			vectors[count].Buffer = block->Data + block->Start;
+			vectors[count].Length = block->End - block->Start;
+		}
+
+		#ifdef WINDOWS
+			if (WSASend((SOCKET)socket->RawSocket, (WSABUF*)vectors, count, &written, 0, NULL, NULL) != 0)
+				return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -WSAGetLastError();
+		#elif defined POSIX
+			memset(&message, 0, sizeof(message));
+			message.msg_iov = (struct iovec*)vectors;
+			message.msg_iovlen = count;
+
+			written = sendmsg(socket->RawSocket, &message, MSG_DONTWAIT | MSG_NOSIGNAL | (block != NULL ? MSG_MORE : 0));
+			if (written < 0) {
+				if (errno == EINTR)
+					continue;
+
+				return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -errno;
+			}
+		#endif
+
+		sent = (uint32)written;
+		queue->Queued -= sent;
+
+		while ((block = queue->Head) != NULL && sent >= block->End - block->Start) {
+			sent -= block->End - block->Start;
+			queue->Head = block->Next;
+			Free(block->Data);
+			Free(block);
+		}
+
+		if (block != NULL)
+			block->Start += sent;
+		else
+			queue->Tail = NULL;
+	}
+
+	return 0;
+}
+
+/* parks a flush on @a socket to send the rest of @a queue once the socket is writable. If that fails, the queue is dropped and the error kept. */
+static void SAL_Socket_WriteQueue_Start(SAL_Socket* socket, SAL_Socket_WriteQueue* queue) {
+	SAL_Socket_Operation* operation;
+
+	operation = SAL_Socket_Operation_Begin(socket, SAL_Socket_Operations_Flush, NULL);
+
+	/* it sends from the queue rather than from a buffer of its own, so it runs on readiness under either engine */
+	operation->Readiness = true;
+
+	if (SAL_Socket_Operation_Submit(operation)) {
+		queue->Operation = operation;
+		return;
+	}
+
+	SAL_Socket_Operation_End(operation);
+	Free(operation);
+
+	SAL_Socket_WriteQueue_Discard(queue);
+	#ifdef WINDOWS
+		queue->Error = -WSAGetLastError();
+	#elif defined POSIX
+		queue->Error = -errno;
+	#endif
+}
+
+/* sends what it can of @a queue now and leaves the rest to a parked flush, unless a flush is parked already */
+static void SAL_Socket_WriteQueue_Push(SAL_Socket* socket, SAL_Socket_WriteQueue* queue) {
+	int32 result;
+
+	if (queue->Operation != NULL || queue->Error < 0)
+		return;
+
+	/* under windows the socket may be blocking, so it is only ever sent to once it is writable */
+	#ifdef POSIX
+		result = SAL_Socket_WriteQueue_Send(socket, queue);
+		if (result < 0) {
+			SAL_Socket_WriteQueue_Discard(queue);
+			queue->Error = result;
+			return;
+		}
+	#endif
+
+	/* a full queue that was sent straight away still goes through the flush, so that it is marked no longer full and the drain callback runs */
+	if (queue->Head != NULL || queue->Full)
+		SAL_Socket_WriteQueue_Start(socket, queue);
+}
+
+/* runs the parked flush of a write queue once its socket is writable. It stays parked until the queue is empty or sending fails. The drain callback runs once a full queue has come down to its low watermark, and on failure. */
+static void SAL_Socket_WriteQueue_Flush(SAL_Socket_Operation* operation) {
+	SAL_Socket* socket;
+	SAL_Socket_WriteQueue* queue;
+	SAL_Socket_CompletionCallback callback;
+	void* callbackState;
+	uint32 queued;
+	int32 result;
+	boolean done;
+	boolean drained;
+
+	socket = operation->Socket;
+	queue = socket->WriteQueue;
+
+	SAL_Mutex_Acquire(queue->Lock);
+
+	result = SAL_Socket_WriteQueue_Send(socket, queue);
+	if (result < 0) {
+		SAL_Socket_WriteQueue_Discard(queue);
+		queue->Error = result;
+	}
+
+	done = queue->Head == NULL;
+	if (done) {
+		queue->Operation = NULL;
+		socket->Entry->PendingWrite = NULL;
+		SAL_Socket_UpdateInterest(socket);
+	}
+
+	drained = result < 0 || (queue->Full && queue->Queued <= queue->LowWatermark);
+	if (drained) {
+		queue->Full = false;
+
+		for (; queue->DrainWaiters > 0; queue->DrainWaiters--)
+			SAL_Semaphore_Increment(queue->Drained);
+	}
+
+	queued = queue->Queued;
+	callback = queue->DrainCallback;
+	callbackState = queue->DrainCallbackState;
+
+	SAL_Mutex_Release(queue->Lock);
+
+	/* ended first so that the callback is free to close the socket */
+	if (done) {
+		SAL_Socket_Operation_End(operation);
+		Free(operation);
+	}
+
+	if (drained && callback != NULL)
+		callback(socket, result < 0 ? result : (int32)queued, callbackState);
+}
+
+/* gets what was just appended to @a queue on its way, unless the socket is corked and not enough has built up yet, and marks the queue full once it is over its high watermark. the queue's lock is held. */
+static void SAL_Socket_WriteQueue_Schedule(SAL_Socket* socket, SAL_Socket_WriteQueue* queue) {
+	/* a corked socket holds on to it until enough has built up */
+	if (!queue->Corked && queue->Operation == NULL)
+		SAL_Socket_WriteQueue_Start(socket, queue);
+	else if (queue->Corked && queue->Queued >= SAL_Socket_CorkLimit)
+		SAL_Socket_WriteQueue_Push(socket, queue);
+
+	if (queue->Queued > queue->HighWatermark)
+		queue->Full = true;
+}
+
+/* keeps the order of what is written to @a socket: while it is corked, or data is still queued ahead, @a vectors join the write queue rather than going straight out. returns false if they may go straight out. otherwise @a status is set, and @a written to the number of bytes queued: all of them, or none if the queue is over its high watermark or sending has failed. */
+static boolean SAL_Socket_WriteQueue_Join(SAL_Socket* socket, const SAL_Socket_IOVector* const vectors, const uint32 count, uint32* const written, uint8* const status) {
+	SAL_Socket_WriteQueue* queue;
+	int32 error;
+	uint32 i;
+	boolean full;
+
+	*written = 0;
+
+	queue = socket->WriteQueue;
+	if (queue == NULL)
+		return false;
+
+	SAL_Mutex_Acquire(queue->Lock);
+
+	error = queue->Error;
+	full = queue->Full;
+
+	if (error == 0 && !queue->Corked && queue->Head == NULL) {
+		SAL_Mutex_Release(queue->Lock);
+		return false;
+	}
+
+	if (error == 0 && !full) {
+		for (i = 0; i < count; i++) {
+			SAL_Socket_WriteQueue_Append(queue, vectors[i].Buffer, (uint32)vectors[i].Length);
+			*written += (uint32)vectors[i].Length;
+		}
+
+		SAL_Socket_WriteQueue_Schedule(socket, queue);
+
+		/* it was dropped again if the flush could not be started */
+		error = queue->Error;
+		if (error != 0)
+			*written = 0;
+	}
+
+	SAL_Mutex_Release(queue->Lock);
+
+	if (error != 0)
+		*status = SAL_Socket_Fail(socket, -error);
+	else if (full)
+		*status = SAL_Socket_Status_WouldBlock;
+	else
+		*status = SAL_Socket_Status_Ok;
+
+	return true;
+}
+
+/* returns true if nothing written to @a socket is queued or held back by a cork, so that a write that can't join the queue may go out without overtaking anything */
+static boolean SAL_Socket_WriteQueue_IsIdle(SAL_Socket* socket) {
+	SAL_Socket_WriteQueue* queue;
+	boolean idle;
+
+	queue = socket->WriteQueue;
+	if (queue == NULL)
+		return true;
+
+	SAL_Mutex_Acquire(queue->Lock);
+	idle = !queue->Corked && queue->Head == NULL;
+	SAL_Mutex_Release(queue->Lock);
+
+	return idle;
+}
+
+/* blocks until the write queue of @a socket has come down to its low watermark, for at most @a milliseconds, if it is over its high watermark. returns false at once if it isn't, in which case it is the socket that is full. */
+static boolean SAL_Socket_WriteQueue_Wait(SAL_Socket* socket, uint32 milliseconds) {
+	SAL_Socket_WriteQueue* queue;
+
+	queue = socket->WriteQueue;
+	if (queue == NULL)
+		return false;
+
+	SAL_Mutex_Acquire(queue->Lock);
+
+	if (!queue->Full || queue->Error != 0) {
+		SAL_Mutex_Release(queue->Lock);
+		return false;
+	}
+
+	queue->DrainWaiters++;
+
+	SAL_Mutex_Release(queue->Lock);
+
+	if (!SAL_Semaphore_DecrementTimeout(queue->Drained, milliseconds)) {
+		/* unless the flush counted it as woken just as it gave up, in which case the next waiter is woken early and checks again */
+		SAL_Mutex_Acquire(queue->Lock);
+		if (queue->DrainWaiters > 0)
+			queue->DrainWaiters--;
+		SAL_Mutex_Release(queue->Lock);
+	}
+
+	return true;
+}
+
+/* blocks until @a socket can take more data, for at most @a milliseconds. returns false if it timed out or failed. */
+static boolean SAL_Socket_WaitWritable(SAL_Socket* socket, uint32 milliseconds) {
+#ifdef WINDOWS
+	fd_set writeSet;
+	struct timeval timeout;
+
+	FD_ZERO(&writeSet);
+	FD_SET((SOCKET)socket->RawSocket, &writeSet);
+	timeout.tv_sec = milliseconds / 1000;
+	timeout.tv_usec = (milliseconds % 1000) * 1000;
+
+	return select(0, NULL, &writeSet, NULL, &timeout) == 1;
+#elif defined POSIX
+	struct pollfd descriptor;
+
+	descriptor.fd = socket->RawSocket;
+	descriptor.events = POLLOUT;
+	descriptor.revents = 0;
+
+	return poll(&descriptor, 1, (int)milliseconds) == 1 && (descriptor.revents & POLLOUT) != 0;
+#endif
+}
+
+/* closes the descriptor of @a socket and returns it to the pool, along with anything left in its write queue */
+static void SAL_Socket_Free(SAL_Socket* socket) {
+	if (socket->WriteQueue != NULL) {
+		if (socket->WriteQueue->AutoFlush)
+			SAL_Socket_Reactor_Uncork(SAL_Socket_Reactor_Of(socket), socket);
+
+		SAL_Socket_WriteQueue_Discard(socket->WriteQueue);
+		SAL_Semaphore_Free(socket->WriteQueue->Drained);
+		SAL_Mutex_Free(socket->WriteQueue->Lock);
+		Free(socket->WriteQueue);
+	}
+
+	/* once the descriptor is closed it can be handed out again, and its entry with it */
+#ifdef WINDOWS
+	closesocket((SOCKET)socket->RawSocket);
+#elif defined POSIX
+	close(socket->RawSocket);
+#endif
+
+	SAL_Socket_Slab_Return(socket);
+}
+
+/* wraps @a descriptor, which must be new: its entry in the table is cleared */
+static SAL_Socket* SAL_Socket_New(uint8 family, uint8 type, uint64 descriptor) {
+	SAL_Socket* socket;
+#ifdef SO_NOSIGPIPE
+	int enable;
+#endif
+	
+#ifdef SO_NOSIGPIPE
+	/* where the platform has it, sendfile and splice report a peer that went away with EPIPE too, rather than by SIGPIPE */
+	enable = 1;
+	setsockopt((int)descriptor, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#endif
+
+	socket = SAL_Socket_Slab_Take();
+	socket->RawSocket = descriptor;
+	socket->Entry = SAL_Socket_Table_Attach(descriptor);
+	if (socket->Entry == NULL) {
+		socket->Entry = &socket->Detached;
+		memset(socket->Entry, 0, sizeof(SAL_Socket_Entry));
+	}
+
+	socket->Connected = false;
+	socket->NonBlocking = false;
+	socket->LastError = 0;
+	socket->Family = family;
+	socket->Type = type;
+	socket->Operations = 0;
+	socket->Reactor = SAL_Socket_Reactor_Unassigned;
+	socket->Sharded = false;
+	socket->ZeroCopyCallbackState = NULL;
+	socket->ZeroCopySequence = 0;
+	socket->WriteQueue = NULL;
+	memset(socket->RemoteEndpointAddress, 0, sizeof(socket->RemoteEndpointAddress));
+
+	return socket;
+}
+
+/* wraps a connection accepted on @a listener, recording the peer's address if @a remoteAddress is given. Connections accepted on a sharded listener stay on its reactor; the others are spread like any other socket. */
+static SAL_Socket* SAL_Socket_NewAccepted(SAL_Socket* listener, uint64 descriptor, const struct sockaddr* const remoteAddress) {
+	SAL_Socket* socket;
+
+	socket = SAL_Socket_New(listener->Family, listener->Type, descriptor);
+	socket->Connected = true;
+
+	/* an IPv4 address takes the first 4 bytes */
+	if (remoteAddress != NULL && remoteAddress->sa_family == AF_INET)
+		memcpy(socket->RemoteEndpointAddress, &((const struct sockaddr_in*)remoteAddress)->sin_addr, 4);
+	else if (remoteAddress != NULL && remoteAddress->sa_family == AF_INET6)
+		memcpy(socket->RemoteEndpointAddress, &((const struct sockaddr_in6*)remoteAddress)->sin6_addr, 16);
+
+	if (listener->Sharded)
+		socket->Reactor = listener->Reactor;
+
+	return socket;
+}
+
+/* FNV-1a over everything that goes into resolving a name */
+static uint32 SAL_Socket_Resolve_Hash(const int8* const address, const int8* port, uint8 family, uint8 type) {
+	const int8* character;
+	uint32 hash;
+
+	hash = 2166136261U;
+
+	for (character = address; *character != '\0'; character++)
+		hash = (hash ^ (uint8)*character) * 16777619U;
+
+	hash = (hash ^ 0xFF) * 16777619U;
+
+	for (character = port; *character != '\0'; character++)
+		hash = (hash ^ (uint8)*character) * 16777619U;
+
+	hash = (hash ^ family) * 16777619U;
+	hash = (hash ^ type) * 16777619U;
+
+	return hash;
+}
+
+/* copies @a string into a new allocation */
+static int8* SAL_Socket_Resolve_Duplicate(const int8* const string) {
+	int8* copy;
+	size_t length;
+
+	length = strlen(string) + 1;
+	copy = AllocateArray(int8, length);
+	memcpy(copy, string, length);
+
+	return copy;
+}
+
+static void SAL_Socket_Resolve_FreeEntry(SAL_Socket_Resolved* entry) {
+	SAL_Socket_Addresses_Free(entry->Addresses);
+	Free(entry->Host);
+	Free(entry->Port);
+	Free(entry);
+}
+
+/* fills in the hints getaddrinfo is given for @a family and @a type. returns false if either is not valid. */
+static boolean SAL_Socket_Resolve_Hints(uint8 family, uint8 type, struct addrinfo* hints) {
+	memset(hints, 0, sizeof(struct addrinfo));
+
+	switch (family) {
+		case SAL_Socket_Families_IPV4: hints->ai_family = AF_INET; break;
+		case SAL_Socket_Families_IPV6: hints->ai_family = AF_INET6; break;
+		case SAL_Socket_Families_IPAny: hints->ai_family = AF_UNSPEC; break;
+		case SAL_Socket_Families_Local: hints->ai_family = AF_UNIX; break;
+		default: return false;
+	}
+
+	switch (type) {
+		case SAL_Socket_Types_TCP: hints->ai_socktype = SOCK_STREAM; break;
+	#ifdef POSIX
+		case SAL_Socket_Types_SeqPacket: hints->ai_socktype = SOCK_SEQPACKET; break;
+	#endif
+		default: return false;
+	}
+
+	/* only a local socket keeps message boundaries on a connection */
+	if (hints->ai_socktype != SOCK_STREAM && hints->ai_family != AF_UNIX)
+		return false;
+
+	return true;
+}
+
+/* resolves @a address and @a port to a list that SAL_Socket_Addresses_Free releases: parsed directly if @a address is a literal, taken from the cache if it was resolved recently, and from the resolver otherwise. returns NULL if it does not resolve. */
+static struct addrinfo* SAL_Socket_Resolve(const int8* const address, const int8* port, uint8 family, uint8 type, boolean passive) {
+	struct addrinfo hints;
+	struct addrinfo* resolved;
+	struct addrinfo* result;
+
+	if (!SAL_Socket_Resolve_Hints(family, type, &hints))
+		return NULL;
+
+	if (hints.ai_family == AF_UNIX)
+		return SAL_Socket_Addresses_Local(port, hints.ai_socktype);
+
+	/* a listener's wildcard address is only looked up when the listener is created, which is not worth caching */
+	if (passive || address == NULL) {
+		if (passive)
+			hints.ai_flags = AI_PASSIVE;
+
+		if (getaddrinfo(address, port, &hints, &resolved) != 0)
+			return NULL;
+
+		result = SAL_Socket_Addresses_Copy(resolved);
+		freeaddrinfo(resolved);
+
+		return result;
+	}
+
+	if (SAL_Socket_Resolve_Lookup(address, port, family, type, &result))
+		return result;
+
+	return SAL_Socket_Resolve_Query(address, port, family, type);
+}
+
+/* answers what can be answered without waiting on the resolver: a literal address, or a name in the cache. returns false if @a address has to be resolved; otherwise @a result receives the addresses, or NULL for a name that is known not to resolve. */
+static boolean SAL_Socket_Resolve_Lookup(const int8* const address, const int8* port, uint8 family, uint8 type, struct addrinfo** result) {
+	struct addrinfo hints;
+
+	if (!SAL_Socket_Resolve_Hints(family, type, &hints)) {
+		*result = NULL;
+		return true;
+	}
+
+	/* a local socket is named, not resolved */
+	if (hints.ai_family == AF_UNIX) {
+		*result = SAL_Socket_Addresses_Local(port, hints.ai_socktype);
+		return true;
+	}
+
+	*result = SAL_Socket_Resolve_Numeric(address, port, hints.ai_family, hints.ai_socktype);
+	if (*result != NULL) {
+		#ifdef WINDOWS
+			InterlockedIncrement64((volatile LONG64*)&resolverStats.Numeric);
+		#elif defined POSIX
+			__atomic_add_fetch(&resolverStats.Numeric, 1, __ATOMIC_RELAXED);
+		#endif
+
+		return true;
+	}
+
+	if (!SAL_Socket_Resolve_Cached(address, port, family, type, result))
+		return false;
+
+	#ifdef WINDOWS
+		InterlockedIncrement64((volatile LONG64*)&resolverStats.Hits);
+	#elif defined POSIX
+		__atomic_add_fetch(&resolverStats.Hits, 1, __ATOMIC_RELAXED);
+	#endif
+
+	return true;
+}
+
+/* looks @a address up in the cache alone, without counting it in the resolver's stats. returns false if it isn't there; otherwise @a result receives the addresses, or NULL for a name that is known not to resolve. */
+static boolean SAL_Socket_Resolve_Cached(const int8* const address, const int8* port, uint8 family, uint8 type, struct addrinfo** result) {
+	SAL_Socket_Resolved* entry;
+	boolean found;
+	uint32 hash;
+	int64 now;
+
+	SAL_Socket_Globals_Initialize();
+
+	hash = SAL_Socket_Resolve_Hash(address, port, family, type);
+	found = false;
+	now = SAL_Time_Now();
+
+	SAL_RWLock_AcquireRead(resolverLock);
+
+	for (entry = resolverCache[hash % SAL_Socket_Resolver_Buckets]; entry != NULL; entry = entry->Next) {
+		if (entry->Hash == hash && entry->Family == family && entry->Type == type && entry->Expires > now && strcmp(entry->Host, address) == 0 && strcmp(entry->Port, port) == 0) {
+			*result = SAL_Socket_Addresses_Copy(entry->Addresses);
+			found = true;
+			break;
+		}
+	}
+
+	SAL_RWLock_ReleaseRead(resolverLock);
+
+	return found;
+}
+
+/* asks the resolver, getaddrinfo unless SAL_Socket_SetResolver replaced it, for @a address, and caches the answer. blocks for as long as the resolver takes. */
+static struct addrinfo* SAL_Socket_Resolve_Query(const int8* const address, const int8* port, uint8 family, uint8 type) {
+	SAL_Socket_Resolved* entry;
+	SAL_Socket_Resolved** link;
+	SAL_Socket_Address answers[SAL_Socket_ResolverMaxAddresses];
+	struct addrinfo hints;
+	struct addrinfo* resolved;
+	struct addrinfo* result;
+	struct addrinfo** tail;
+	SAL_Socket_ResolverFunction resolver;
+	void* resolverState;
+	uint32 hash;
+	uint32 ttl;
+	uint32 count;
+	uint32 i;
+	uint16 portNumber;
+	int64 now;
+	int64 elapsed;
+
+	SAL_Socket_Resolve_Hints(family, type, &hints);
+
+	SAL_Socket_Globals_Initialize();
+
+	SAL_RWLock_AcquireRead(resolverLock);
+	resolver = resolverFunction;
+	resolverState = resolverFunctionState;
+	SAL_RWLock_ReleaseRead(resolverLock);
+
+	result = NULL;
+	now = SAL_Time_Now();
+
+	if (resolver == NULL) {
+		if (getaddrinfo(address, port, &hints, &resolved) == 0) {
+			result = SAL_Socket_Addresses_Copy(resolved);
+			freeaddrinfo(resolved);
+		}
+	}
+	else if (SAL_Socket_Resolve_Port(port, &portNumber)) {
+		count = resolver(address, family, answers, SAL_Socket_ResolverMaxAddresses, resolverState);
+
+		tail = &result;
+		for (i = 0; i < count && i < SAL_Socket_ResolverMaxAddresses; i++) {
+			if (answers[i].Family == SAL_Socket_Families_IPV6 ? hints.ai_family == AF_INET : hints.ai_family == AF_INET6)
+				continue;
+
+			*tail = SAL_Socket_Addresses_Build(answers[i].Family == SAL_Socket_Families_IPV6 ? AF_INET6 : AF_INET, answers[i].Address, portNumber, hints.ai_socktype);
+			tail = &(*tail)->ai_next;
+		}
+	}
+
+	elapsed = SAL_Time_Now() - now;
+	now += elapsed;
+	hash = SAL_Socket_Resolve_Hash(address, port, family, type);
+	ttl = result != NULL ? resolverTTL : resolverNegativeTTL;
+
+	SAL_RWLock_AcquireWrite(resolverLock);
+
+	resolverStats.Misses++;
+	resolverStats.ResolveTime += (uint64)elapsed;
+	if ((uint64)elapsed > resolverStats.MaxResolveTime)
+		resolverStats.MaxResolveTime = (uint64)elapsed;
+	if (result == NULL)
+		resolverStats.Failures++;
+
+	if (ttl > 0) {
+		/* expired entries in the bucket make way, as does one for the same name if another thread resolved it meanwhile */
+		link = &resolverCache[hash % SAL_Socket_Resolver_Buckets];
+		while ((entry = *link) != NULL) {
+			if (entry->Expires <= now || (entry->Hash == hash && entry->Family == family && entry->Type == type && strcmp(entry->Host, address) == 0 && strcmp(entry->Port, port) == 0)) {
+				*link = entry->Next;
+				resolverEntries--;
+				SAL_Socket_Resolve_FreeEntry(entry);
+			}
+			else {
+				link = &entry->Next;
+			}
+		}
+
+		if (resolverEntries < SAL_Socket_Resolver_MaxEntries) {
+			entry = Allocate(SAL_Socket_Resolved);
+			entry->Hash = hash;
+			entry->Host = SAL_Socket_Resolve_Duplicate(address);
+			entry->Port = SAL_Socket_Resolve_Duplicate(port);
+			entry->Family = family;
+			entry->Type = type;
+			entry->Expires = now + ttl;
+			entry->Addresses = SAL_Socket_Addresses_Copy(result);
+			entry->Next = resolverCache[hash % SAL_Socket_Resolver_Buckets];
+
+			resolverCache[hash % SAL_Socket_Resolver_Buckets] = entry;
+			resolverEntries++;
+		}
+	}
+
+	SAL_RWLock_ReleaseWrite(resolverLock);
+
+	return result;
+}
+
+/* hands @a address to the resolver threads, or joins the lookup of it that they already have. @a callback is called on one of them with the addresses, which it then owns, or NULL. */
+static void SAL_Socket_Resolve_Queue(const int8* const address, const int8* port, uint8 family, uint8 type, SAL_Socket_ResolvedCallback callback, void* const state) {
+	SAL_Socket_Lookup* lookup;
+	SAL_Socket_LookupWaiter* waiter;
+	uint32 hash;
+	uint32 i;
+
+	hash = SAL_Socket_Resolve_Hash(address, port, family, type);
+
+	waiter = Allocate(SAL_Socket_LookupWaiter);
+	waiter->Callback = callback;
+	waiter->State = state;
+
+	SAL_Socket_Globals_Initialize();
+
+	SAL_Mutex_Acquire(resolverQueueLock);
+
+	for (lookup = resolverPending[hash % SAL_Socket_Resolver_PendingBuckets]; lookup != NULL; lookup = lookup->NextPending)
+		if (lookup->Hash == hash && lookup->Family == family && lookup->Type == type && strcmp(lookup->Host, address) == 0 && strcmp(lookup->Port, port) == 0)
+			break;
+
+	if (lookup != NULL) {
+		waiter->Next = lookup->Waiters;
+		lookup->Waiters = waiter;
+
+		#ifdef WINDOWS
+			InterlockedIncrement64((volatile LONG64*)&resolverStats.Coalesced);
+		#elif defined POSIX
+			__atomic_add_fetch(&resolverStats.Coalesced, 1, __ATOMIC_RELAXED);
+		#endif
+
+		SAL_Mutex_Release(resolverQueueLock);
+
+		return;
+	}
+
+	lookup = Allocate(SAL_Socket_Lookup);
+	lookup->Hash = hash;
+	lookup->Host = SAL_Socket_Resolve_Duplicate(address);
+	lookup->Port = SAL_Socket_Resolve_Duplicate(port);
+	lookup->Family = family;
+	lookup->Type = type;
+	lookup->Waiters = waiter;
+	lookup->NextQueued = NULL;
+	lookup->NextPending = resolverPending[hash % SAL_Socket_Resolver_PendingBuckets];
+	waiter->Next = NULL;
+
+	resolverPending[hash % SAL_Socket_Resolver_PendingBuckets] = lookup;
+
+	if (resolverQueueTail != NULL)
+		resolverQueueTail->NextQueued = lookup;
+	else
+		resolverQueueHead = lookup;
+	resolverQueueTail = lookup;
+
+	/* the threads are only started by the first name that has to wait on the resolver */
+	if (resolverQueued == NULL) {
+		resolverQueued = SAL_Semaphore_Create();
+
+		for (i = 0; i < SAL_Socket_Resolver_Threads; i++)
+			SAL_Thread_Create(SAL_Socket_Resolve_Run, NULL);
+	}
+
+	SAL_Mutex_Release(resolverQueueLock);
+
+	SAL_Semaphore_Increment(resolverQueued);
+}
+
+/* a resolver thread: takes the oldest queued lookup, resolves it and answers everyone who joined it meanwhile */
+static SAL_Thread_Start(SAL_Socket_Resolve_Run) {
+	SAL_Socket_Lookup* lookup;
+	SAL_Socket_Lookup** link;
+	SAL_Socket_LookupWaiter* waiter;
+	SAL_Socket_LookupWaiter* next;
+	struct addrinfo* result;
+
+	while (true) {
+		SAL_Semaphore_Decrement(resolverQueued);
+
+		SAL_Mutex_Acquire(resolverQueueLock);
+
+		lookup = resolverQueueHead;
+		resolverQueueHead = lookup->NextQueued;
+		if (resolverQueueHead == NULL)
+			resolverQueueTail = NULL;
+
+		SAL_Mutex_Release(resolverQueueLock);
+
+		/* the name may have been cached by a lookup that finished after this one was queued. It is checked without counting, so that one lookup is never counted twice. */
+		if (!SAL_Socket_Resolve_Cached(lookup->Host, lookup->Port, lookup->Family, lookup->Type, &result))
+			result = SAL_Socket_Resolve_Query(lookup->Host, lookup->Port, lookup->Family, lookup->Type);
+
+		/* from here on, lookups of the name start over, and find it in the cache */
+		SAL_Mutex_Acquire(resolverQueueLock);
+
+		for (link = &resolverPending[lookup->Hash % SAL_Socket_Resolver_PendingBuckets]; *link != lookup; link = &(*link)->NextPending)
+			;
+		*link = lookup->NextPending;
+
+		SAL_Mutex_Release(resolverQueueLock);
+
+		/* every waiter gets a list of its own; the last gets the original */
+		for (waiter = lookup->Waiters; waiter != NULL; waiter = next) {
+			next = waiter->Next;
+
+			waiter->Callback(next != NULL ? SAL_Socket_Addresses_Copy(result) : result, waiter->State);
+			Free(waiter);
+		}
+
+		Free(lookup->Host);
+		Free(lookup->Port);
+		Free(lookup);
+	}
+
+	return 0;
+}
+
+/* parses @a port as a decimal port number. returns false if it is anything else, such as a service name. */
+static boolean SAL_Socket_Resolve_Port(const int8* const port, uint16* number) {
+	const int8* digit;
+	uint32 value;
+
+	value = 0;
+	for (digit = port; *digit != '\0'; digit++) {
+		if (*digit < '0' || *digit > '9' || digit - port >= 5)
+			return false;
+
+		value = value * 10 + (uint32)(*digit - '0');
+	}
+
+	if (digit == port || value > 65535)
+		return false;
+
+	*number = (uint16)value;
+
+	return true;
+}
+
+/* parses @a address as a literal IPv4 or IPv6 address, and @a port as a number, without going near the resolver. returns NULL if either is anything else, or the address is not of @a family. */
+static struct addrinfo* SAL_Socket_Resolve_Numeric(const int8* const address, const int8* port, int family, int type) {
+	uint16 portNumber;
+	uint8 parsed[16];
+
+	if (!SAL_Socket_Resolve_Port(port, &portNumber))
+		return NULL;
+
+	if (family != AF_INET6 && inet_pton(AF_INET, address, parsed) == 1)
+		return SAL_Socket_Addresses_Build(AF_INET, parsed, portNumber, type);
+	else if (family != AF_INET && inet_pton(AF_INET6, address, parsed) == 1)
+		return SAL_Socket_Addresses_Build(AF_INET6, parsed, portNumber, type);
+
+	return NULL;
+}
+
+/* builds a single address of @a family, an AF_ value, from the 4 or 16 bytes of @a address */
+static struct addrinfo* SAL_Socket_Addresses_Build(int family, const uint8* const address, uint16 port, int type) {
+	struct addrinfo* result;
+	struct sockaddr_in* address4;
+	struct sockaddr_in6* address6;
+	size_t length;
+
+	length = family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+
+	result = (struct addrinfo*)AllocateArray(uint8, sizeof(struct addrinfo) + length);
+	memset(result, 0, sizeof(struct addrinfo) + length);
+
+	if (family == AF_INET6) {
+		address6 = (struct sockaddr_in6*)(result + 1);
+		address6->sin6_family = AF_INET6;
+		address6->sin6_port = htons(port);
+		memcpy(&address6->sin6_addr, address, 16);
+	}
+	else {
+		address4 = (struct sockaddr_in*)(result + 1);
+		address4->sin_family = AF_INET;
+		address4->sin_port = htons(port);
+		memcpy(&address4->sin_addr, address, 4);
+	}
+
+	result->ai_family = family;
+	result->ai_socktype = type;
+	result->ai_protocol = type == SOCK_STREAM ? IPPROTO_TCP : 0;
+	result->ai_addrlen = (socklen_t)length;
+	result->ai_addr = (struct sockaddr*)(result + 1);
+
+	return result;
+}
+
+/* builds the address of a local socket from its @a name: a path, or under Linux a name in the abstract namespace if it starts with '@'. returns NULL if the name is empty or too long, or starts with '@' anywhere else. */
+static struct addrinfo* SAL_Socket_Addresses_Local(const int8* const name, int type) {
+	struct addrinfo* result;
+	struct sockaddr_un* address;
+	size_t length;
+
+	length = strlen(name);
+	if (length == 0 || length >= sizeof(address->sun_path))
+		return NULL;
+
+#ifndef __linux__
+	/* there is no abstract namespace to put it in, and a file by that name is not what was asked for */
+	if (name[0] == '@')
+		return NULL;
+#endif
+
+	result = (struct addrinfo*)AllocateArray(uint8, sizeof(struct addrinfo) + sizeof(struct sockaddr_un));
+	memset(result, 0, sizeof(struct addrinfo) + sizeof(struct sockaddr_un));
+
+	address = (struct sockaddr_un*)(result + 1);
+	address->sun_family = AF_UNIX;
+	memcpy(address->sun_path, name, length);
+
+#ifdef __linux__
+	/* the '@' becomes the leading 0 of an abstract name, which is as long as it says and has no terminator */
+	if (name[0] == '@')
+		address->sun_path[0] = '\0';
+#endif
+
+	result->ai_family = AF_UNIX;
+	result->ai_socktype = type;
+	result->ai_protocol = 0;
+	result->ai_addrlen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + length + (address->sun_path[0] != '\0' ? 1 : 0));
+	result->ai_addr = (struct sockaddr*)(result + 1);
+
+	return result;
+}
+
+/* copies a list of addresses, each node into an allocation of its own so that the nodes can be split up and freed apart */
+static struct addrinfo* SAL_Socket_Addresses_Copy(const struct addrinfo* addresses) {
+	struct addrinfo* result;
+	struct addrinfo** link;
+	struct addrinfo* copy;
+
+	result = NULL;
+	link = &result;
+
+	for (; addresses != NULL; addresses = addresses->ai_next) {
+		copy = (struct addrinfo*)AllocateArray(uint8, sizeof(struct addrinfo) + addresses->ai_addrlen);
+		memcpy(copy, addresses, sizeof(struct addrinfo));
+		memcpy(copy + 1, addresses->ai_addr, addresses->ai_addrlen);
+
+		copy->ai_addr = (struct sockaddr*)(copy + 1);
+		copy->ai_canonname = NULL;
+		copy->ai_next = NULL;
+
+		*link = copy;
+		link = &copy->ai_next;
+	}
+
+	return result;
+}
+
+static void SAL_Socket_Addresses_Free(struct addrinfo* addresses) {
+	struct addrinfo* next;
+
+	for (; addresses != NULL; addresses = next) {
+		next = addresses->ai_next;
+		Free(addresses);
+	}
+}
+
+/* opens a socket that can connect to @a address */
+static SAL_Socket* SAL_Socket_Open(const struct addrinfo* address, uint8 family, uint8 type) {
+#ifdef WINDOWS
+	SOCKET rawSocket;
+#elif defined POSIX
+	int rawSocket;
+#endif
+
+	rawSocket = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+#ifdef WINDOWS
+	if (rawSocket == INVALID_SOCKET)
+		return NULL;
+#elif defined POSIX
+	if (rawSocket == -1)
+		return NULL;
+#endif
+
+	return SAL_Socket_New(family, type, (uint64)rawSocket);
+}
+
+/* removes the file a local socket was bound to by a listener that is gone, so that @a address can be bound again: only a socket file that refuses connections is removed, and a listener that is still there sees the probe as a connection that closes straight away. an abstract name goes with its last descriptor, so there is nothing to remove. */
+static void SAL_Socket_RemoveStale(const struct addrinfo* address) {
+	const struct sockaddr_un* local;
+	boolean stale;
+#ifdef WINDOWS
+	SOCKET probe;
+	DWORD attributes;
+#elif defined POSIX
+	int probe;
+	struct stat status;
+#endif
+
+	if (address->ai_family != AF_UNIX)
+		return;
+
+	local = (const struct sockaddr_un*)address->ai_addr;
+	if (local->sun_path[0] == '\0')
+		return;
+
+#ifdef WINDOWS
+	/* a bound socket shows up as a reparse point */
+	attributes = GetFileAttributesA(local->sun_path);
+	if (attributes == INVALID_FILE_ATTRIBUTES || (attributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0)
+		return;
+
+	probe = socket(AF_UNIX, address->ai_socktype, 0);
+	if (probe == INVALID_SOCKET)
+		return;
+
+	stale = connect(probe, address->ai_addr, (int)address->ai_addrlen) != 0 && WSAGetLastError() == WSAECONNREFUSED;
+	closesocket(probe);
+
+	if (stale)
+		DeleteFileA(local->sun_path);
+#elif defined POSIX
+	if (stat(local->sun_path, &status) != 0 || !S_ISSOCK(status.st_mode))
+		return;
+
+	/* non-blocking, so that a live listener with a full backlog answers EAGAIN rather than holding the probe */
+	probe = socket(AF_UNIX, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (probe == -1)
+		return;
+
+	stale = connect(probe, address->ai_addr, address->ai_addrlen) != 0 && errno == ECONNREFUSED;
+	close(probe);
+
+	if (stale)
+		unlink(local->sun_path);
+#endif
+}
+
+static SAL_Socket* SAL_Socket_PrepareRawSocket(const int8* const address, const int8* port, uint8 family, uint8 type, boolean willListenOn, struct addrinfo** addressInfo) {
+	struct addrinfo* serverAddrInfo;
+	SAL_Socket* listener;
+
+#ifdef WINDOWS
+	if (!winsockInitialized) {
+		WSADATA startupData;
+		WSAStartup(514, &startupData);
+		winsockInitialized = true;
+	}
+#endif
+
+	serverAddrInfo = SAL_Socket_Resolve(address, port, family, type, willListenOn);
+	if (serverAddrInfo == NULL) {
+		return NULL;
+	}
+
+	listener = SAL_Socket_Open(serverAddrInfo, family, type);
+	if (listener == NULL) {
+		SAL_Socket_Addresses_Free(serverAddrInfo);
+		return NULL;
+	}
+
+	*addressInfo = serverAddrInfo;
+
+	return listener;
+}
+
+
+
+
+/**
+ * Create a TCP connection to a host.
+ *
+ * For @ref SAL_Socket_Families_Local, @a port names the socket to connect to
+ * instead, a path or, under Linux, an '@' and a name in the abstract
+ * namespace, and @a address is ignored.
+ *
+ * @param address A string specifying the hostname to connect to
+ * @param port Port to connect to
+ */
+SAL_Socket* SAL_Socket_Connect(const int8* const address, const int8* port, uint8 family, uint8 type) {
+	SAL_Socket* server;
+	struct addrinfo* serverAddrInfo;
+	
+	server = SAL_Socket_PrepareRawSocket(address, port, family, type, false, &serverAddrInfo);
+	if (server == NULL) {
+		return NULL;
+	}
+	if (connect(server->RawSocket, serverAddrInfo->ai_addr, (int)serverAddrInfo->ai_addrlen) != 0) {
+		goto error;
+	}
+	
+	SAL_Socket_Addresses_Free(serverAddrInfo);
+
+	server->Connected = true;
+
+	return server;
+
+error:
+	SAL_Socket_Addresses_Free(serverAddrInfo);
+	SAL_Socket_Free(server);
+
+	return NULL;
+}
+
+/**
+ * Create a listening socket on all interfaces.
+ *
+ * For @ref SAL_Socket_Families_Local, @a port names the socket to listen on
+ * instead. A socket file at that path that is left over from a listener that
+ * is gone is replaced; one that still accepts connections is not.
+ *
+ * @param port String with the port number or name (e.g, "http" or "80")
+ * @returns a socket you can call @ref SAL_Socket_Accept on
+ */
+SAL_Socket* SAL_Socket_Listen(const int8* const port, uint8 family, uint8 type) {
+	SAL_Socket* listener;
+	struct addrinfo* serverAddrInfo;
+
+	listener = SAL_Socket_PrepareRawSocket(NULL, port, family, type, false, &serverAddrInfo);
+	if (listener == NULL) {
+		return NULL;
+	}
+
+	SAL_Socket_RemoveStale(serverAddrInfo);
+
+	if (bind(listener->RawSocket, serverAddrInfo->ai_addr, (int)serverAddrInfo->ai_addrlen) != 0) {
+		goto error;
+	}
+
+	if (listen(listener->RawSocket, SOMAXCONN) != 0) {
+		goto error;
+	}
+	
+	SAL_Socket_Addresses_Free(serverAddrInfo);
+
+	listener->Connected = true;
+
+	return listener;
+
+error:
+	SAL_Socket_Addresses_Free(serverAddrInfo);
+	SAL_Socket_Free(listener);
+
+	return NULL;
+}
+
+/**
+ * Create one listening socket per reactor, all on the same port, and let the
+ * kernel share incoming connections between them (SO_REUSEPORT). Listener @a i
+ * belongs to reactor @a i, as do the connections accepted on it, so each
+ * reactor accepts and serves its share without contending with the others.
+ *
+ * @param port String with the port number or name (e.g, "http" or "80")
+ * @param listeners Receives the listeners; must have room for
+ * @ref SAL_Socket_GetReactorCount of them
+ * @param steer If true, and there is one reactor per processor, a connection
+ * goes to the listener of the reactor that matches the processor the kernel
+ * received it on, and each reactor's thread is restricted to that processor.
+ * With any other number of reactors the kernel balances connections as
+ * usual, since no processor would map to exactly one reactor.
+ * @returns the number of listeners created, 0 on failure
+ *
+ * @warning Under windows, and for @ref SAL_Socket_Families_Local, a single
+ * listener is created, as there is no SO_REUSEPORT to balance connections
+ * between several.
+ */
+uint32 SAL_Socket_ListenSharded(const int8* const port, uint8 family, uint8 type, SAL_Socket** listeners, boolean steer) {
+	SAL_Socket* listener;
+	struct addrinfo* serverAddrInfo;
+	uint32 count;
+	uint32 created;
+	uint32 i;
+#ifdef POSIX
+	uint32 processors;
+	int reusePort;
+	struct sock_filter steeringCode[3];
+	struct sock_fprog steeringProgram;
+#endif
+
+	assert(listeners != NULL);
+
+#ifdef WINDOWS
+	count = 1;
+#elif defined POSIX
+	count = family == SAL_Socket_Families_Local ? 1 : SAL_Socket_GetReactorCount();
+#endif
+
+	for (created = 0; created < count; created++) {
+		listener = SAL_Socket_PrepareRawSocket(NULL, port, family, type, true, &serverAddrInfo);
+		if (listener == NULL)
+			goto error;
+
+		listeners[created] = listener;
+		listener->Reactor = created;
+		listener->Sharded = true;
+
+		#ifdef POSIX
+			reusePort = 1;
+			setsockopt(listener->RawSocket, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(reusePort));
+		#endif
+
+		SAL_Socket_RemoveStale(serverAddrInfo);
+
+		/* the kernel numbers the sockets of the group in the order they start listening, which is the order the steering program picks them by */
+		if (bind(listener->RawSocket, serverAddrInfo->ai_addr, (int)serverAddrInfo->ai_addrlen) != 0 || listen(listener->RawSocket, SOMAXCONN) != 0) {
+			SAL_Socket_Addresses_Free(serverAddrInfo);
+			created++;
+			goto error;
+		}
+
+		SAL_Socket_Addresses_Free(serverAddrInfo);
+
+		listener->Connected = true;
+	}
+
+#ifdef POSIX
+	processors = SAL_Thread_GetProcessorCount();
+
+	/* with more reactors than processors some would never be picked, and with fewer some processors would hand their connections to a reactor pinned elsewhere */
+	if (steer && family != SAL_Socket_Families_Local && count == processors) {
+		/* A = the processor the connection arrived on, modulo the number of listeners in case processors are numbered past those online */
+		steeringCode[0].code = BPF_LD | BPF_W | BPF_ABS;
+		steeringCode[0].jt = 0;
+		steeringCode[0].jf = 0;
+		steeringCode[0].k = (uint32)(SKF_AD_OFF + SKF_AD_CPU);
+		steeringCode[1].code = BPF_ALU | BPF_MOD | BPF_K;
+		steeringCode[1].jt = 0;
+		steeringCode[1].jf = 0;
+		steeringCode[1].k = count;
+		steeringCode[2].code = BPF_RET | BPF_A;
+		steeringCode[2].jt = 0;
+		steeringCode[2].jf = 0;
+		steeringCode[2].k = 0;
+
+		steeringProgram.len = 3;
+		steeringProgram.filter = steeringCode;
+
+		/* the program applies to the whole group whichever socket it is attached to */
+		if (setsockopt(listeners[0]->RawSocket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &steeringProgram, sizeof(steeringProgram)) != 0)
+			goto error;
+
+		for (i = 0; i < count; i++)
+			SAL_Socket_Reactor_SetProcessor(&reactors[i], i);
+	}
+#endif
+
+	return count;
+
+error:
+	while (created > 0)
+		SAL_Socket_Close(listeners[--created]);
+
+	return 0;
+}
+
+/**
+ * Accept an incoming connection on a listening socket (one created by @ref
+ * SAL_Socket_Listen). The client's address is stored in the new socket's
+ * RemoteEndpointAddress: 4 network bytes for IPv4, 16 for IPv6, and none for
+ * a local socket.
+ *
+ * @param listener The listening socket to accept a connection on
+ * @returns the new socket, or NULL if accepting failed
+ */
+SAL_Socket* SAL_Socket_Accept(SAL_Socket* listener) {
+	SAL_Socket* socket;
+	struct sockaddr_storage remoteAddress;
+
+#ifdef WINDOWS
+	SOCKET rawSocket;
+	int addressLength = sizeof(remoteAddress);
+	
+	rawSocket = accept((SOCKET)listener->RawSocket, (struct sockaddr*)&remoteAddress, &addressLength);
+	if (rawSocket == INVALID_SOCKET) {
+		return NULL;
+	}
+#elif defined POSIX
+	int rawSocket;
+	socklen_t addressLength = sizeof(remoteAddress);
+
+	rawSocket = accept4(listener->RawSocket, (struct sockaddr*)&remoteAddress, &addressLength, SOCK_CLOEXEC);
+	if (rawSocket == -1) {
+		return NULL;
+	}
+	
+#endif
+
+	socket = SAL_Socket_NewAccepted(listener, (uint64)rawSocket, (struct sockaddr*)&remoteAddress);
+
+	return socket;
+}
+
+/**
+ * Accept every connection waiting on @a listener, up to @a maxAccepted of
+ * them, without blocking. Each socket's RemoteEndpointAddress is filled as by
+ * @ref SAL_Socket_Accept.
+ *
+ * @param listener The listening socket to accept connections on
+ * @param accepted Receives the new sockets
+ * @param maxAccepted Number of sockets @a accepted has room for
+ * @returns the number of sockets stored in @a accepted, 0 if none were waiting
+ *
+ * @warning @a listener is left non-blocking, and so are the new sockets;
+ * they are meant for read callbacks and the asynchronous operations.
+ */
+uint32 SAL_Socket_AcceptMany(SAL_Socket* listener, SAL_Socket** accepted, uint32 maxAccepted) {
+	struct sockaddr_storage remoteAddress;
+	uint32 count;
+#ifdef WINDOWS
+	SOCKET rawSocket;
+	int addressLength;
+#elif defined POSIX
+	int rawSocket;
+	socklen_t addressLength;
+#endif
+
+	assert(listener != NULL);
+	assert(accepted != NULL);
+
+	SAL_Socket_SetBlocking(listener, false);
+
+	count = 0;
+	while (count < maxAccepted) {
+		addressLength = sizeof(remoteAddress);
+
+		/* under windows the new socket inherits the listener's non-blocking mode; accept4 sets it without another call */
+		#ifdef WINDOWS
+			rawSocket = accept((SOCKET)listener->RawSocket, (struct sockaddr*)&remoteAddress, &addressLength);
+			if (rawSocket == INVALID_SOCKET)
+				break;
+		#elif defined POSIX
+			rawSocket = accept4(listener->RawSocket, (struct sockaddr*)&remoteAddress, &addressLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (rawSocket == -1) {
+				/* a connection reset while it waited doesn't end the batch */
+				if (errno == EINTR || errno == ECONNABORTED)
+					continue;
+				break;
+			}
+		#endif
+
+		accepted[count++] = SAL_Socket_NewAccepted(listener, (uint64)rawSocket, (struct sockaddr*)&remoteAddress);
+	}
+
+	return count;
+}
+
+/**
+ * Disconnect and close the socket.
+ *
+ * @param socket Socket to close
+ */
+void SAL_Socket_Close(SAL_Socket* socket) {
+	assert(socket != NULL);
+
+	SAL_Socket_UnsetSocketCallback(socket);
+	socket->Connected = false;
+#ifdef WINDOWS
+	shutdown((SOCKET)socket->RawSocket, SD_BOTH);
+#elif defined POSIX
+	shutdown(socket->RawSocket, SHUT_RDWR);
+#endif
+
+	/* operations are still in flight; the last to complete closes and frees the socket, possibly already on its reactor */
+	if (SAL_Socket_Operation_CancelAll(socket))
+		return;
+
+	SAL_Socket_Free(socket);
+}
+
+/**
+ * Read up to @a bufferSize bytes into @a buffer from @a socket.
+ *
+ * @param socket Socket to read from
+ * @param buffer Address to write the read data too
+ * @param bufferSize Size of @a buffer
+ * @returns Number of bytes read, 0 if the connection was closed, reading
+ * failed or, on a non-blocking socket, there was nothing to read; use
+ * @ref SAL_Socket_TryRead to tell these apart
+ */
+uint32 SAL_Socket_Read(SAL_Socket* socket, uint8* const buffer, const uint32 bufferSize) {
+	uint32 read;
+
+	SAL_Socket_TryRead(socket, buffer, bufferSize, &read);
+
+	return read;
+}
+
+/**
+ * Send @a writeAmount bytes from @a toWrite over @a socket.
+ *
+ * @param socket Socket to write to
+ * @param toWrite Buffer to write from
+ * @param writeAmount Number of bytes to write
+ * @returns number of bytes sent, 0 if sending failed or, on a non-blocking
+ * socket, there was no room; use @ref SAL_Socket_TryWrite to tell these apart
+ */
+uint32 SAL_Socket_Write(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount) {
+	uint32 written;
+
+	SAL_Socket_TryWrite(socket, toWrite, writeAmount, &written);
+
+	return written;
+}
+
+/**
+ * Read up to @a bufferSize bytes into @a buffer from @a socket, telling apart
+ * why nothing was read. On a socket made non-blocking with
+ * @ref SAL_Socket_SetNonBlocking it never waits, which is what a loop driven
+ * by edge-triggered readiness needs: read until @ref SAL_Socket_Status_WouldBlock.
+ *
+ * @param socket Socket to read from
+ * @param buffer Address to write the read data too
+ * @param bufferSize Size of @a buffer
+ * @param read Set to the number of bytes read, 0 unless the status is
+ * @ref SAL_Socket_Status_Ok
+ * @returns one of the SAL_Socket_Status_ values. A failure other than
+ * @ref SAL_Socket_Status_WouldBlock is recorded for
+ * @ref SAL_Socket_GetLastError.
+ */
+uint8 SAL_Socket_TryRead(SAL_Socket* socket, uint8* const buffer, const uint32 bufferSize, uint32* const read) {
+	int32 received;
+
+	assert(socket != NULL);
+	assert(buffer != NULL);
+	assert(read != NULL);
+
+	*read = 0;
+
+#ifdef WINDOWS
+	received = recv((SOCKET)socket->RawSocket, (int8* const)buffer, bufferSize, 0);
+	if (received < 0)
+		return SAL_Socket_Fail(socket, WSAGetLastError());
+#elif defined POSIX
+	do
+		received = recv(socket->RawSocket, (int8* const)buffer, bufferSize, 0);
+	while (received < 0 && errno == EINTR);
+
+	if (received < 0)
+		return SAL_Socket_Fail(socket, errno);
+#endif
+
+	if (received == 0 && bufferSize > 0)
+		return SAL_Socket_Status_Closed;
+
+	*read = (uint32)received;
+
+	return SAL_Socket_Status_Ok;
+}
+
+/**
+ * Look at whether anything is waiting to be read on @a socket without
+ * reading it or waiting for it, whether or not the socket is blocking. A
+ * connection sitting idle should have nothing waiting: data there is a reply
+ * nobody read, and end of stream means the peer has closed it.
+ *
+ * @param socket Socket to look at
+ * @returns @ref SAL_Socket_Status_WouldBlock if the connection is open and
+ * nothing is waiting, @ref SAL_Socket_Status_Ok if data is waiting, or
+ * @ref SAL_Socket_Status_Closed or @ref SAL_Socket_Status_Error as
+ * @ref SAL_Socket_TryRead would return them
+ */
+uint8 SAL_Socket_Peek(SAL_Socket* socket) {
+	int32 received;
+	int8 waiting;
+#ifdef WINDOWS
+	fd_set readSet;
+	struct timeval timeout;
+#endif
+
+	assert(socket != NULL);
+
+#ifdef WINDOWS
+	/* there is no MSG_DONTWAIT, so only peek at a socket that won't block */
+	FD_ZERO(&readSet);
+	FD_SET((SOCKET)socket->RawSocket, &readSet);
+	timeout.tv_sec = 0;
+	timeout.tv_usec = 0;
+
+	if (select(0, &readSet, NULL, NULL, &timeout) == 0)
+		return SAL_Socket_Status_WouldBlock;
+
+	received = recv((SOCKET)socket->RawSocket, &waiting, 1, MSG_PEEK);
+	if (received < 0)
+		return SAL_Socket_Fail(socket, WSAGetLastError());
+#elif defined POSIX
+	do
+		received = recv(socket->RawSocket, &waiting, 1, MSG_PEEK | MSG_DONTWAIT);
+	while (received < 0 && errno == EINTR);
+
+	if (received < 0)
+		return SAL_Socket_Fail(socket, errno);
+#endif
+
+	return received == 0 ? SAL_Socket_Status_Closed : SAL_Socket_Status_Ok;
+}
+
+/**
+ * Send up to @a writeAmount bytes from @a toWrite over @a socket, telling
+ * apart why less was sent. On a socket made non-blocking with
+ * @ref SAL_Socket_SetNonBlocking it never waits.
+ *
+ * @param socket Socket to write to
+ * @param toWrite Buffer to write from
+ * @param writeAmount Number of bytes to write
+ * @param written Set to the number of bytes sent, which may be less than
+ * @a writeAmount; 0 unless the status is @ref SAL_Socket_Status_Ok
+ * @returns one of the SAL_Socket_Status_ values. A failure other than
+ * @ref SAL_Socket_Status_WouldBlock is recorded for
+ * @ref SAL_Socket_GetLastError.
+ *
+ * @warning While @a socket is corked, or its write queue still holds data,
+ * the write joins the queue whole to keep its order, as with
+ * @ref SAL_Socket_QueueWrite. Once the queue is over its high watermark it
+ * takes nothing more and this returns @ref SAL_Socket_Status_WouldBlock.
+ */
+uint8 SAL_Socket_TryWrite(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, uint32* const written) {
+	SAL_Socket_IOVector vector;
+	int32 result;
+	uint8 status;
+
+	assert(socket != NULL);
+	assert(toWrite != NULL);
+	assert(written != NULL);
+
+	*written = 0;
+
+	/* while the socket is corked, or data is still queued ahead of this, it joins the write queue to keep its order */
+	vector.Buffer = (uint8*)toWrite;
+	vector.Length = writeAmount;
+	if (SAL_Socket_WriteQueue_Join(socket, &vector, 1, written, &status))
+		return status;
+
+#ifdef WINDOWS
+	result = send((SOCKET)socket->RawSocket, (const int8*)toWrite, writeAmount, 0);
+	if (result < 0)
+		return SAL_Socket_Fail(socket, WSAGetLastError());
+#elif defined POSIX
+	/* a peer that went away is reported as closed rather than by SIGPIPE */
+	do
+		result = send(socket->RawSocket, (const int8*)toWrite, writeAmount, MSG_NOSIGNAL);
+	while (result < 0 && errno == EINTR);
+
+	if (result < 0)
+		return SAL_Socket_Fail(socket, errno);
+#endif
+
+	*written = (uint32)result;
+
+	return SAL_Socket_Status_Ok;
+}
+
+/**
+ * Make reads and writes on @a socket return at once rather than wait, with
+ * @ref SAL_Socket_Status_WouldBlock from @ref SAL_Socket_TryRead and
+ * @ref SAL_Socket_TryWrite when they would have.
+ *
+ * @param socket The socket
+ * @param nonBlocking Whether the socket should be non-blocking
+ */
+void SAL_Socket_SetNonBlocking(SAL_Socket* socket, boolean nonBlocking) {
+	assert(socket != NULL);
+
+	socket->NonBlocking = nonBlocking;
+
+	SAL_Socket_SetBlocking(socket, !nonBlocking);
+}
+
+/**
+ * @param socket The socket
+ * @returns the error (errno, or WSAGetLastError under windows) of the last
+ * read or write on @a socket that failed, or 0 if none has
+ */
+uint32 SAL_Socket_GetLastError(SAL_Socket* socket) {
+	assert(socket != NULL);
+
+	return socket->LastError;
+}
+
+/**
+ * Send @a writeAmount bytes from @a toWrite over @a socket trying @a maxAttempts times to send the data before giving up.
+ * Between attempts it waits, for longer after each attempt, for the write queue to drain if it is over its high watermark, or else for the socket to become writable.
+ * To write without blocking the calling thread at all, use @ref SAL_Socket_QueueWrite.
+ *
+ * @param socket Socket to write to
+ * @param toWrite Buffer to write from
+ * @param writeAmount Number of bytes to write
+ * @param maxAttempts Number of times to try and send all the data
+ * @param written Set to the number of bytes sent, even if the status is not
+ * @ref SAL_Socket_Status_Ok
+ * @returns @ref SAL_Socket_Status_Ok once all of @a toWrite is sent,
+ * @ref SAL_Socket_Status_WouldBlock if the attempts ran out first, in which
+ * case the caller still owns the rest of the data, or the status that ended
+ * the attempts at once. A failure is recorded for @ref SAL_Socket_GetLastError.
+ */
+uint8 SAL_Socket_TryEnsureWrite(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, uint8 maxAttempts, uint32* const written) {
+	uint32 sent;
+	uint8 status;
+	uint8 tries;
+
+	assert(socket != NULL);
+	assert(toWrite != NULL);
+	assert(written != NULL);
+
+	*written = 0;
+	tries = 0;
+
+	while (true) {
+		/* goes through the write queue like SAL_Socket_Write, so that it can't overtake what is corked or queued */
+		status = SAL_Socket_TryWrite(socket, toWrite + *written, writeAmount - *written, &sent);
+		if (status != SAL_Socket_Status_Ok && status != SAL_Socket_Status_WouldBlock)
+			return status;
+
+		*written += sent;
+
+		if (*written == writeAmount)
+			return SAL_Socket_Status_Ok;
+
+		if (++tries == maxAttempts)
+			return SAL_Socket_Status_WouldBlock;
+
+		/* a full queue only takes more once the reactor has drained it, which the socket becoming writable says nothing about */
+		if (!SAL_Socket_WriteQueue_Wait(socket, tries * 50))
+			SAL_Socket_WaitWritable(socket, tries * 50);
+	}
+}
+
+/**
+ * Send @a writeAmount bytes from @a toWrite over @a socket trying @a maxAttempts times to send the data before giving up.
+ * See @ref SAL_Socket_TryEnsureWrite for how it waits between attempts.
+ *
+ * @param socket Socket to write to
+ * @param toWrite Buffer to write from
+ * @param writeAmount Number of bytes to write
+ * @param maxAttempts Number of times to try and send all the data
+ * @returns the number of bytes that were sent; less than @a writeAmount if
+ * sending failed or the attempts ran out.
+ */
+uint32 SAL_Socket_EnsureWrite(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, uint8 maxAttempts) {
+	uint32 written;
+
+	SAL_Socket_TryEnsureWrite(socket, toWrite, writeAmount, maxAttempts, &written);
+
+	return written;
+}
+
+/**
+ * Read into the buffers of @a vectors in order, with a single call, up to
+ * their combined length.
+ *
+ * @param socket Socket to read from
+ * @param vectors The buffers to fill
+ * @param count Number of entries in @a vectors
+ * @returns Number of bytes read, 0 if the connection was closed or reading
+ * failed. Use @ref SAL_Socket_TryReadV to tell those apart.
+ */
+uint32 SAL_Socket_ReadV(SAL_Socket* socket, SAL_Socket_IOVector* const vectors, const uint32 count) {
+	uint32 read;
+
+	SAL_Socket_TryReadV(socket, vectors, count, &read);
+
+	return read;
+}
+
+/**
+ * Read into the buffers of @a vectors in order, with a single call, up to
+ * their combined length, telling apart why nothing was read as
+ * @ref SAL_Socket_TryRead does.
+ *
+ * @param socket Socket to read from
+ * @param vectors The buffers to fill
+ * @param count Number of entries in @a vectors
+ * @param read Set to the number of bytes read, 0 unless the status is
+ * @ref SAL_Socket_Status_Ok
+ * @returns one of the SAL_Socket_Status_ values. A failure other than
+ * @ref SAL_Socket_Status_WouldBlock is recorded for
+ * @ref SAL_Socket_GetLastError.
+ */
+uint8 SAL_Socket_TryReadV(SAL_Socket* socket, SAL_Socket_IOVector* const vectors, const uint32 count, uint32* const read) {
+	uint64 length;
+	uint32 i;
+#ifdef WINDOWS
+	DWORD received;
+	DWORD flags;
+#elif defined POSIX
+	struct msghdr message;
+	ssize_t received;
+#endif
+
+	assert(socket != NULL);
+	assert(vectors != NULL);
+	assert(read != NULL);
+
+	*read = 0;
+
+#ifdef WINDOWS
+	flags = 0;
+	if (WSARecv((SOCKET)socket->RawSocket, (WSABUF*)vectors, count, &received, &flags, NULL, NULL) != 0)
+		return SAL_Socket_Fail(socket, WSAGetLastError());
+#elif defined POSIX
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = (struct iovec*)vectors;
+	message.msg_iovlen = count;
+
+	do
+		received = recvmsg(socket->RawSocket, &message, 0);
+	while (received < 0 && errno == EINTR);
+
+	if (received < 0)
+		return SAL_Socket_Fail(socket, errno);
+#endif
+
+	/* reading into nothing at all is not the end of the stream */
+	for (length = 0, i = 0; i < count; i++)
+		length += vectors[i].Length;
+
+	if (received == 0 && length > 0)
+		return SAL_Socket_Status_Closed;
+
+	*read = (uint32)received;
+
+	return SAL_Socket_Status_Ok;
+}
+
+/**
+ * Send the buffers of @a vectors in order with a single call, so that a
+ * header and a payload kept apart go out together without being copied into
+ * one buffer first.
+ *
+ * @param socket Socket to write to
+ * @param vectors The buffers to send
+ * @param count Number of entries in @a vectors
+ * @returns number of bytes sent, which may be less than the combined length;
+ * 0 if sending failed
+ */
+uint32 SAL_Socket_WriteV(SAL_Socket* socket, const SAL_Socket_IOVector* const vectors, const uint32 count) {
+	uint32 sent;
+
+	assert(socket != NULL);
+	assert(vectors != NULL);
+
+	SAL_Socket_SendVectors(socket, vectors, count, &sent);
+
+	return sent;
+}
+
+/* sends @a vectors with a single call like SAL_Socket_TryWrite, returning one of the SAL_Socket_Status_ values */
+static uint8 SAL_Socket_SendVectors(SAL_Socket* socket, const SAL_Socket_IOVector* const vectors, const uint32 count, uint32* const sent) {
+	uint8 status;
+#ifdef WINDOWS
+	DWORD result;
+#elif defined POSIX
+	struct msghdr message;
+	ssize_t result;
+#endif
+
+	*sent = 0;
+
+	/* like SAL_Socket_TryWrite, it joins the write queue while anything is held back there */
+	if (SAL_Socket_WriteQueue_Join(socket, vectors, count, sent, &status))
+		return status;
+
+#ifdef WINDOWS
+	if (WSASend((SOCKET)socket->RawSocket, (WSABUF*)vectors, count, &result, 0, NULL, NULL) != 0)
+		return SAL_Socket_Fail(socket, WSAGetLastError());
+#elif defined POSIX
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = (struct iovec*)vectors;
+	message.msg_iovlen = count;
+
+	do
+		result = sendmsg(socket->RawSocket, &message, MSG_NOSIGNAL);
+	while (result < 0 && errno == EINTR);
+
+	if (result < 0)
+		return SAL_Socket_Fail(socket, errno);
+#endif
+
+	*sent = (uint32)result;
+
+	return SAL_Socket_Status_Ok;
+}
+
+/**
+ * Send all the buffers of @a vectors trying @a maxAttempts times before
+ * giving up, picking up where a partial write stopped.
+ *
+ * @param socket Socket to write to
+ * @param vectors The buffers to send. Entries are changed in place as partial
+ * writes are resumed.
+ * @param count Number of entries in @a vectors
+ * @param maxAttempts Number of times to try and send all the data
+ * @returns the number of bytes that were sent; less than the combined length
+ * if sending failed, which ends the attempts at once, or the attempts ran out.
+ */
+uint32 SAL_Socket_EnsureWriteV(SAL_Socket* socket, SAL_Socket_IOVector* vectors, uint32 count, uint8 maxAttempts) {
+	uint32 sentSoFar;
+	uint32 sent;
+	uint8 status;
+	uint8 tries;
+
+	assert(socket != NULL);
+	assert(vectors != NULL);
+
+	sentSoFar = 0;
+	tries = 0;
+
+	/* skips empty buffers up front */
+	count = SAL_Socket_AdvanceVectors(&vectors, count, 0);
+
+	while (count > 0) {
+		/* only a full socket or queue is worth waiting on; a connection that failed won't recover */
+		status = SAL_Socket_SendVectors(socket, vectors, count, &sent);
+		if (status != SAL_Socket_Status_Ok && status != SAL_Socket_Status_WouldBlock)
+			break;
+
+		sentSoFar += sent;
+		count = SAL_Socket_AdvanceVectors(&vectors, count, sent);
+
+		tries++;
+
+		if (count == 0 || tries == maxAttempts)
+			break;
+
+		if (!SAL_Socket_WriteQueue_Wait(socket, tries * 50))
+			SAL_Socket_WaitWritable(socket, tries * 50);
+	}
+
+	return sentSoFar;
+}
+
+/**
+ * Send @a writeAmount bytes from @a toWrite without ever blocking the calling
+ * thread. What the socket does not take straight away is copied into its
+ * write queue, which the socket's reactor sends as the socket becomes
+ * writable, in order and after anything queued before it.
+ *
+ * @param socket Socket to write to
+ * @param toWrite Buffer to write from; it may be reused as soon as this returns
+ * @param writeAmount Number of bytes to write
+ * @returns true if more may be written. false once the queue holds more than
+ * its high watermark, or if sending has failed; a producer should then hold
+ * off until the drain callback set with @ref SAL_Socket_SetWriteQueue runs.
+ * The data is queued either way, unless sending has failed.
+ *
+ * @warning While anything is queued, the queue is the socket's one
+ * outstanding write. Whatever is still queued is dropped when the socket is
+ * closed.
+ */
+boolean SAL_Socket_QueueWrite(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount) {
+	SAL_Socket_WriteQueue* queue;
+	uint32 sentSoFar;
+	boolean accepted;
+#ifdef POSIX
+	ssize_t sent;
+#endif
+
+	assert(socket != NULL);
+	assert(toWrite != NULL);
+
+	queue = SAL_Socket_WriteQueue_Get(socket);
+	sentSoFar = 0;
+
+	SAL_Mutex_Acquire(queue->Lock);
+
+	if (queue->Error < 0) {
+		SAL_Mutex_Release(queue->Lock);
+		return false;
+	}
+
+#ifdef POSIX
+	/* with nothing queued ahead of it, it goes straight out for as long as the socket takes it. A failure is left for the reactor's flush to run into and report. */
+	while (!queue->Corked && queue->Head == NULL && sentSoFar < writeAmount) {
+		sent = send(socket->RawSocket, toWrite + sentSoFar, writeAmount - sentSoFar, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (sent > 0)
+			sentSoFar += (uint32)sent;
+		else if (sent < 0 && errno == EINTR)
+			continue;
+		else
+			break;
+	}
+#endif
+
+	if (sentSoFar < writeAmount) {
+		SAL_Socket_WriteQueue_Append(queue, toWrite + sentSoFar, writeAmount - sentSoFar);
+		SAL_Socket_WriteQueue_Schedule(socket, queue);
+	}
+
+	accepted = !queue->Full && queue->Error == 0;
+
+	SAL_Mutex_Release(queue->Lock);
+
+	return accepted;
+}
+
+/**
+ * Hold back what is written to @a socket, with SAL_Socket_Write, its
+ * variants or SAL_Socket_QueueWrite, until @ref SAL_Socket_Flush is called, so that many
+ * small writes go out as full segments in a few system calls. The writes are
+ * collected in the socket's write queue; once 64 KiB have built up they are
+ * sent without waiting for the flush.
+ *
+ * When corked from one of its callbacks, the socket is flushed by its reactor
+ * at the end of the round, if the callbacks have not flushed it themselves.
+ *
+ * @param socket Socket to cork
+ */
+void SAL_Socket_Cork(SAL_Socket* socket) {
+	SAL_Socket_WriteQueue* queue;
+	SAL_Socket_Reactor* reactor;
+
+	assert(socket != NULL);
+
+	queue = SAL_Socket_WriteQueue_Get(socket);
+	reactor = currentReactor;
+
+	SAL_Mutex_Acquire(queue->Lock);
+
+	queue->Corked = true;
+
+	if (reactor != NULL && reactor == SAL_Socket_Reactor_Of(socket) && !queue->AutoFlush) {
+		queue->AutoFlush = true;
+		queue->NextCorked = reactor->Corked;
+		reactor->Corked = socket;
+	}
+
+	SAL_Mutex_Release(queue->Lock);
+}
+
+/**
+ * Send everything written to @a socket since it was corked, and stop holding
+ * writes back. What the socket doesn't take straight away is sent by its
+ * reactor as with @ref SAL_Socket_QueueWrite.
+ *
+ * @param socket Socket to flush
+ * @returns false if sending has failed
+ */
+boolean SAL_Socket_Flush(SAL_Socket* socket) {
+	SAL_Socket_WriteQueue* queue;
+	boolean succeeded;
+
+	assert(socket != NULL);
+
+	queue = socket->WriteQueue;
+	if (queue == NULL)
+		return true;
+
+	SAL_Mutex_Acquire(queue->Lock);
+
+	queue->Corked = false;
+	SAL_Socket_WriteQueue_Push(socket, queue);
+	succeeded = queue->Error == 0;
+
+	SAL_Mutex_Release(queue->Lock);
+
+	return succeeded;
+}
+
+/**
+ * Set the limits of the write queue of @a socket, and the callback that lets
+ * a producer held off by @ref SAL_Socket_QueueWrite know it may carry on.
+ *
+ * @param socket Socket whose queue to set up
+ * @param highWatermark Number of queued bytes above which SAL_Socket_QueueWrite
+ * returns false
+ * @param lowWatermark Number of queued bytes the queue has to come down to
+ * before @a drainCallback runs; 0 waits for it to empty
+ * @param drainCallback Called on the socket's reactor thread with the number
+ * of bytes still queued once a full queue has come down to @a lowWatermark,
+ * or with a negated error code if sending failed, in which case everything
+ * queued was dropped. May be NULL.
+ * @param state Passed to @a drainCallback
+ */
+void SAL_Socket_SetWriteQueue(SAL_Socket* socket, uint32 highWatermark, uint32 lowWatermark, SAL_Socket_CompletionCallback drainCallback, void* const state) {
+	SAL_Socket_WriteQueue* queue;
+
+	assert(socket != NULL);
+	assert(lowWatermark <= highWatermark);
+
+	queue = SAL_Socket_WriteQueue_Get(socket);
+
+	SAL_Mutex_Acquire(queue->Lock);
+	queue->HighWatermark = highWatermark;
+	queue->LowWatermark = lowWatermark;
+	queue->DrainCallback = drainCallback;
+	queue->DrainCallbackState = state;
+	SAL_Mutex_Release(queue->Lock);
+}
+
+/**
+ * @param socket Socket to check
+ * @returns Number of bytes in the write queue of @a socket that it has not
+ * sent yet
+ */
+uint32 SAL_Socket_GetQueuedBytes(SAL_Socket* socket) {
+	uint32 queued;
+
+	assert(socket != NULL);
+
+	if (socket->WriteQueue == NULL)
+		return 0;
+
+	SAL_Mutex_Acquire(socket->WriteQueue->Lock);
+	queued = socket->WriteQueue->Queued;
+	SAL_Mutex_Release(socket->WriteQueue->Lock);
+
+	return queued;
+}
+
+/**
+ * Send @a length bytes of the file at @a path, starting @a offset bytes in,
+ * without reading it into memory first: the kernel copies it straight from
+ * the page cache to the socket.
+ *
+ * On a blocking socket this returns once everything was sent or sending
+ * failed. On a non-blocking socket it returns as soon as the socket would
+ * block; call it again from @a offset plus the returned count once the
+ * socket is writable, or use @ref SAL_Socket_SendFileAsync.
+ *
+ * @param socket Socket to write to
+ * @param path The file to send
+ * @param offset Where in the file to start
+ * @param length Number of bytes to send, or 0 for everything from @a offset
+ * to the end of the file
+ * @returns the number of bytes sent; 0 without sending anything while
+ * @a socket is corked or its write queue holds data, which the file would
+ * otherwise overtake
+ *
+ * @warning sendfile takes no MSG_NOSIGNAL. Where sockets have no
+ * SO_NOSIGPIPE, as under Linux, a peer that has gone away raises SIGPIPE, so
+ * a process using this should ignore SIGPIPE.
+ */
+uint64 SAL_Socket_SendFile(SAL_Socket* socket, const int8* const path, uint64 offset, uint64 length) {
+	uint64 size;
+	uint64 sentSoFar;
+	int32 result;
+#ifdef WINDOWS
+	HANDLE file;
+#elif defined POSIX
+	int file;
+#endif
+
+	assert(socket != NULL);
+	assert(path != NULL);
+
+	if (!SAL_Socket_WriteQueue_IsIdle(socket))
+		return 0;
+
+	if (!SAL_Socket_OpenFile(path, &file, &size))
+		return 0;
+
+	if (offset > size)
+		offset = size;
+	if (length == 0 || length > size - offset)
+		length = size - offset;
+
+	sentSoFar = 0;
+	while (sentSoFar < length) {
+		result = SAL_Socket_TransmitFile(socket, file, &offset, length - sentSoFar);
+
+		#ifdef POSIX
+			if (result < 0 && errno == EINTR)
+				continue;
+		#endif
+
+		if (result <= 0)
+			break;
+
+		sentSoFar += (uint32)result;
+	}
+
+#ifdef WINDOWS
+	CloseHandle(file);
+#elif defined POSIX
+	close(file);
+#endif
+
+	return sentSoFar;
+}
+
+/**
+ * Let @a socket send large writes made with @ref SAL_Socket_WriteZeroCopy
+ * straight from the caller's buffer, without copying it into the kernel.
+ * @a callback is called on the socket's reactor thread as the kernel
+ * finishes with those buffers, with the first and last sequence numbers of
+ * the sends it is done with.
+ *
+ * @param socket Socket to enable zero copy sends on
+ * @param callback Called as sent buffers are released
+ * @param state Passed to @a callback
+ * @returns true if the kernel supports zero copy sends on @a socket
+ *
+ * @warning Only available on Linux 4.14 or newer. A callback reporting its
+ * sends as copied means the kernel could not avoid the copy, for instance on
+ * loopback, and plain writes would be cheaper.
+ */
+boolean SAL_Socket_EnableZeroCopy(SAL_Socket* socket, SAL_Socket_ZeroCopyCallback callback, void* const state) {
+#ifdef POSIX
+	int enable;
+#endif
+
+	assert(socket != NULL);
+	assert(callback != NULL);
+
+#ifdef WINDOWS
+	return false;
+#elif defined POSIX
+	enable = 1;
+	if (setsockopt(socket->RawSocket, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) != 0)
+		return false;
+
+	socket->Entry->ZeroCopyCallback = callback;
+	socket->ZeroCopyCallbackState = state;
+
+	if (!SAL_Socket_UpdateInterest(socket)) {
+		socket->Entry->ZeroCopyCallback = NULL;
+		socket->ZeroCopyCallbackState = NULL;
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+/**
+ * Send @a writeAmount bytes from @a toWrite over @a socket without copying
+ * them, if zero copy was enabled with @ref SAL_Socket_EnableZeroCopy and the
+ * write is at least @ref SAL_Socket_ZeroCopyThreshold bytes long.
+ *
+ * @param socket Socket to write to
+ * @param toWrite Buffer to write from. If @a sequence is set, it must not be
+ * changed or freed until the zero copy callback has reported that sequence
+ * number.
+ * @param writeAmount Number of bytes to write
+ * @param sequence Receives the sequence number of the send, or
+ * @ref SAL_Socket_ZeroCopy_None if the data was copied as by @ref
+ * SAL_Socket_Write and the buffer is free again already. It is always
+ * copied while @a socket is corked or its write queue holds data.
+ * @returns number of bytes sent, 0 if sending failed. Use
+ * @ref SAL_Socket_TryWriteZeroCopy to find out why.
+ */
+uint32 SAL_Socket_WriteZeroCopy(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, uint32* const sequence) {
+	uint32 written;
+
+	SAL_Socket_TryWriteZeroCopy(socket, toWrite, writeAmount, sequence, &written);
+
+	return written;
+}
+
+/**
+ * Send @a writeAmount bytes from @a toWrite over @a socket as
+ * @ref SAL_Socket_WriteZeroCopy does, telling apart why nothing was sent as
+ * @ref SAL_Socket_TryWrite does.
+ *
+ * @param socket Socket to write to
+ * @param toWrite Buffer to write from; see @ref SAL_Socket_WriteZeroCopy
+ * @param writeAmount Number of bytes to write
+ * @param sequence Receives the sequence number of the send, or
+ * @ref SAL_Socket_ZeroCopy_None if the data was copied or not sent
+ * @param written Set to the number of bytes sent, 0 unless the status is
+ * @ref SAL_Socket_Status_Ok
+ * @returns one of the SAL_Socket_Status_ values. A failure other than
+ * @ref SAL_Socket_Status_WouldBlock is recorded for
+ * @ref SAL_Socket_GetLastError.
+ */
+uint8 SAL_Socket_TryWriteZeroCopy(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, uint32* const sequence, uint32* const written) {
+#ifdef POSIX
+	int32 result;
+#endif
+
+	assert(socket != NULL);
+	assert(toWrite != NULL);
+	assert(sequence != NULL);
+	assert(written != NULL);
+
+	*sequence = SAL_Socket_ZeroCopy_None;
+	*written = 0;
+
+#ifdef POSIX
+	/* while writes are held back in the write queue, it is copied in behind them like any other write */
+	if (socket->Entry->ZeroCopyCallback != NULL && writeAmount >= SAL_Socket_ZeroCopyThreshold && SAL_Socket_WriteQueue_IsIdle(socket)) {
+		do
+			result = send(socket->RawSocket, toWrite, writeAmount, MSG_ZEROCOPY | MSG_NOSIGNAL);
+		while (result < 0 && errno == EINTR);
+
+		/* the kernel numbers every send it accepts with MSG_ZEROCOPY, partial ones included */
+		if (result >= 0) {
+			*sequence = socket->ZeroCopySequence++;
+			*written = (uint32)result;
+
+			return SAL_Socket_Status_Ok;
+		}
+
+		/* ENOBUFS means the socket has pinned all the memory it may for now, which a copy doesn't need */
+		if (errno != ENOBUFS)
+			return SAL_Socket_Fail(socket, errno);
+	}
+#endif
+
+	return SAL_Socket_TryWrite(socket, toWrite, writeAmount, written);
+}
+
+/**
+ * Register @a callback to be called whenever data is available on @a socket.
+ * The callback reads the data itself, with @ref SAL_Socket_Read; see
+ * @ref SAL_Socket_SetDataCallback to be handed it instead.
+ *
+ * @param socket Socket to read from
+ * @param callback The callback to call
+ * @param state Passed to @a callback
+ */
+void SAL_Socket_SetReadCallback(SAL_Socket* socket, SAL_Socket_ReadCallback callback, void* const state) {
+	assert(socket != NULL);
+	assert(callback != NULL);
+	assert(state != NULL);
+	assert(socket->Entry->PendingRead == NULL);
+	assert(socket->Entry->DataCallback == NULL);
+
+	/* the callback has to be in place before the reactor can see the socket */
+	socket->Entry->ReadCallback = callback;
+	socket->Entry->ReadCallbackState = state;
+
+	if (!SAL_Socket_UpdateInterest(socket)) {
+		socket->Entry->ReadCallback = NULL;
+		socket->Entry->ReadCallbackState = NULL;
+	}
+}
+
+/**
+ * Register @a callback to be handed the data that arrives on @a socket. The
+ * reactor reads it into a buffer from a pool it shares between its
+ * connections, so no connection holds a buffer of its own between reads.
+ *
+ * @param socket Socket to read from
+ * @param callback The callback to call. It gets the buffer, and the data and
+ * its length within it; a length of 0 means the connection was closed or
+ * failed, and the callback has been unregistered.
+ * @param state Passed to @a callback
+ *
+ * @warning The buffer goes back to the pool once @a callback returns. To keep
+ * the data for longer, take a reference with @ref SAL_Buffer_Reference and
+ * release it with @ref SAL_Buffer_Release when done; that may happen on any
+ * thread.
+ */
+void SAL_Socket_SetDataCallback(SAL_Socket* socket, SAL_Socket_DataCallback callback, void* const state) {
+	assert(socket != NULL);
+	assert(callback != NULL);
+	assert(socket->Entry->PendingRead == NULL);
+	assert(socket->Entry->ReadCallback == NULL);
+
+	socket->Entry->DataCallback = callback;
+	socket->Entry->ReadCallbackState = state;
+
+	if (!SAL_Socket_UpdateInterest(socket)) {
+		socket->Entry->DataCallback = NULL;
+		socket->Entry->ReadCallbackState = NULL;
+	}
+}
+
+/**
+ * Unregisters all callbacks for @a socket.
+ *
+ * @param socket The socket to clear all callbacks from
+ */
+void SAL_Socket_UnsetSocketCallback(SAL_Socket* socket) {
+	assert(socket != NULL);
+
+	if (socket->Entry->ReadCallback || socket->Entry->DataCallback || socket->Entry->ZeroCopyCallback) {
+		socket->Entry->ReadCallback = NULL;
+		socket->Entry->DataCallback = NULL;
+		socket->Entry->ReadCallbackState = NULL;
+		socket->Entry->ZeroCopyCallback = NULL;
+		socket->ZeroCopyCallbackState = NULL;
+
+		SAL_Socket_UpdateInterest(socket);
+	}
+}
+
+/**
+ * Choose how asynchronous operations are carried out. Must be called before
+ * any callback is registered or operation started; later calls have no
+ * effect.
+ *
+ * @param engine One of the SAL_Socket_Engines_* values
+ * @returns the engine in use, which is @ref SAL_Socket_Engines_Epoll if the
+ * io_uring engine was asked for but the kernel does not support it
+ */
+uint8 SAL_Socket_SetEngine(uint8 engine) {
+	SAL_Socket_Globals_Initialize();
+
+	SAL_Mutex_Acquire(reactorsLock);
+	if (reactors == NULL)
+		asyncEngine = engine;
+	SAL_Mutex_Release(reactorsLock);
+
+	SAL_Socket_Reactor_InitializeAll();
+
+	return asyncEngine;
+}
+
+/**
+ * @returns the engine asynchronous operations are carried out with
+ */
+uint8 SAL_Socket_GetEngine(void) {
+	return asyncEngine;
+}
+
+/**
+ * Choose how many reactors run callbacks and asynchronous operations, each
+ * on a thread of its own. Must be called before @ref SAL_Socket_SetEngine
+ * and before any callback is registered or operation started; later calls
+ * have no effect.
+ *
+ * @param count Number of reactors, or 0 for one per processor
+ * @returns the number of reactors that will be used
+ */
+uint32 SAL_Socket_SetReactorCount(uint32 count) {
+	SAL_Socket_Globals_Initialize();
+
+	SAL_Mutex_Acquire(reactorsLock);
+	if (reactors == NULL)
+		reactorCount = count > 0 ? count : SAL_Thread_GetProcessorCount();
+	SAL_Mutex_Release(reactorsLock);
+
+	return reactorCount;
+}
+
+/**
+ * @returns the number of reactors, which is one per processor unless
+ * @ref SAL_Socket_SetReactorCount said otherwise
+ */
+uint32 SAL_Socket_GetReactorCount(void) {
+	SAL_Socket_Reactor_InitializeAll();
+
+	return reactorCount;
+}
+
+/**
+ * Pin @a socket to reactor @a reactor, so that all of its callbacks run on
+ * that reactor's thread. Sockets that are not pinned are spread across the
+ * reactors by descriptor.
+ *
+ * @param socket Socket to pin
+ * @param reactor Index of the reactor, below @ref SAL_Socket_GetReactorCount
+ *
+ * @warning Must be called before a callback is registered or an operation
+ * started on @a socket; a socket never moves once it has been used.
+ */
+void SAL_Socket_SetReactor(SAL_Socket* socket, uint32 reactor) {
+	assert(socket != NULL);
+	assert(reactor < SAL_Socket_GetReactorCount());
+	assert(socket->Entry->Interest == 0 && socket->Operations == 0);
+
+	socket->Reactor = reactor;
+}
+
+/**
+ * @returns the index of the reactor @a socket belongs to
+ */
+uint32 SAL_Socket_GetReactor(SAL_Socket* socket) {
+	assert(socket != NULL);
+
+	return SAL_Socket_Reactor_Of(socket)->Index;
+}
+
+/**
+ * Receive up to @a bufferSize bytes into @a buffer without blocking the
+ * calling thread. @a callback is called on the socket's reactor thread with
+ * the number of bytes read, 0 if the peer closed the connection or a negated
+ * error code.
+ *
+ * @param socket Socket to read from
+ * @param buffer Buffer to read into; it must stay valid until @a callback runs
+ * @param bufferSize Size of @a buffer
+ * @param callback Called once the read completes
+ * @param state Passed to @a callback
+ * @returns true if the read was started
+ *
+ * @warning Only one read (or accept) can be outstanding on a socket, and not
+ * while a read callback is registered on it.
+ */
+boolean SAL_Socket_ReadAsync(SAL_Socket* socket, uint8* const buffer, const uint32 bufferSize, SAL_Socket_CompletionCallback callback, void* const state) {
+	SAL_Socket_Operation* operation;
+
+	assert(socket != NULL);
+	assert(buffer != NULL);
+	assert(callback != NULL);
+	assert(socket->Entry->ReadCallback == NULL && socket->Entry->DataCallback == NULL);
+
+	operation = SAL_Socket_Operation_Begin(socket, SAL_Socket_Operations_Read, state);
+	operation->Buffer = buffer;
+	operation->Length = bufferSize;
+	operation->CompletionCallback = callback;
+
+	if (!SAL_Socket_Operation_Submit(operation)) {
+		SAL_Socket_Operation_End(operation);
+		Free(operation);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Send @a writeAmount bytes from @a toWrite without blocking the calling
+ * thread. @a callback is called on the socket's reactor thread once all of it
+ * has been sent, with @a writeAmount, or a negated error code.
+ *
+ * @param socket Socket to write to
+ * @param toWrite Buffer to write from; it must stay valid until @a callback runs
+ * @param writeAmount Number of bytes to write
+ * @param callback Called once the write completes
+ * @param state Passed to @a callback
+ * @returns true if the write was started
+ *
+ * @warning Only one write can be outstanding on a socket.
+ */
+boolean SAL_Socket_WriteAsync(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, SAL_Socket_CompletionCallback callback, void* const state) {
+	SAL_Socket_Operation* operation;
+
+	assert(socket != NULL);
+	assert(toWrite != NULL);
+	assert(callback != NULL);
+
+	operation = SAL_Socket_Operation_Begin(socket, SAL_Socket_Operations_Write, state);
+	operation->Buffer = (uint8*)toWrite;
+	operation->Length = writeAmount;
+	operation->CompletionCallback = callback;
+
+	if (!SAL_Socket_Operation_Submit(operation)) {
+		SAL_Socket_Operation_End(operation);
+		Free(operation);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Send @a length bytes of the file at @a path, starting @a offset bytes in,
+ * without blocking the calling thread and without reading the file into
+ * memory. The socket's reactor sends as much as the socket takes each time
+ * it becomes writable. @a callback is called on the reactor thread with 0
+ * once the whole range has been sent, or a negated error code.
+ *
+ * @param socket Socket to write to
+ * @param path The file to send
+ * @param offset Where in the file to start
+ * @param length Number of bytes to send, or 0 for everything from @a offset
+ * to the end of the file
+ * @param callback Called once the transfer completes
+ * @param state Passed to @a callback
+ * @returns true if the transfer was started
+ *
+ * @warning This counts as the socket's one outstanding write, and is not
+ * started while @a socket is corked or its write queue holds data. @a socket
+ * is made non-blocking for the transfer. As with @ref SAL_Socket_SendFile, a
+ * process using this should ignore SIGPIPE.
+ */
+boolean SAL_Socket_SendFileAsync(SAL_Socket* socket, const int8* const path, uint64 offset, uint64 length, SAL_Socket_CompletionCallback callback, void* const state) {
+	SAL_Socket_Operation* operation;
+	uint64 size;
+
+	assert(socket != NULL);
+	assert(path != NULL);
+	assert(callback != NULL);
+
+	if (!SAL_Socket_WriteQueue_IsIdle(socket))
+		return false;
+
+	operation = SAL_Socket_Operation_Begin(socket, SAL_Socket_Operations_SendFile, state);
+	operation->CompletionCallback = callback;
+
+	/* there is no ring operation for it, so it runs on readiness under either engine */
+	operation->Readiness = true;
+
+	if (!SAL_Socket_OpenFile(path, &operation->File, &size)) {
+		SAL_Socket_Operation_End(operation);
+		Free(operation);
+		return false;
+	}
+
+	if (offset > size)
+		offset = size;
+	if (length == 0 || length > size - offset)
+		length = size - offset;
+
+	operation->FileOffset = offset;
+	operation->FileRemaining = length;
+	operation->RestoreBlocking = SAL_Socket_IsBlocking(socket);
+	if (operation->RestoreBlocking)
+		SAL_Socket_SetBlocking(socket, false);
+
+	if (!SAL_Socket_Operation_Submit(operation)) {
+		SAL_Socket_Operation_Release(operation);
+
+		if (operation->RestoreBlocking)
+			SAL_Socket_SetBlocking(socket, true);
+
+		SAL_Socket_Operation_End(operation);
+		Free(operation);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Pass everything that arrives on @a first to @a second and the other way
+ * round, without the data ever being copied into user space: it is spliced
+ * through a pipe per direction. When one side stops sending, the other side
+ * is shut down for writing and the opposite direction carries on. @a callback
+ * is called on the sockets' reactor thread once both directions are done,
+ * with the byte counts each way and 0, or with a negated error code as soon
+ * as either side fails.
+ *
+ * @param first One end of the relay
+ * @param second The other end; it is moved to the reactor of @a first
+ * @param callback Called once the relay has finished
+ * @param state Passed to @a callback
+ * @returns true if the relay was started
+ *
+ * @warning Neither socket may have a read callback or an outstanding
+ * operation, and both are made non-blocking. Closing either socket ends the
+ * relay without calling @a callback; do so from a callback on the sockets'
+ * reactor, as the relay may be running there. Only available under POSIX.
+ * splice takes no MSG_NOSIGNAL, so where sockets have no SO_NOSIGPIPE, as
+ * under Linux, a process using this should ignore SIGPIPE.
+ */
+boolean SAL_Socket_Relay(SAL_Socket* first, SAL_Socket* second, SAL_Socket_RelayCallback callback, void* const state) {
+#ifdef WINDOWS
+	return false;
+#elif defined POSIX
+	SAL_Socket_RelayState* relay;
+	SAL_Socket_Operation* operation;
+	uint32 i;
+	int pipeSize;
+
+	assert(first != NULL);
+	assert(second != NULL);
+	assert(callback != NULL);
+	assert(first->Entry->Interest == 0 && first->Operations == 0);
+	assert(second->Entry->Interest == 0 && second->Operations == 0);
+
+	/* an idle socket can still be moved, and on one reactor the two directions never run at once */
+	second->Reactor = SAL_Socket_Reactor_Of(first)->Index;
+
+	SAL_Socket_SetBlocking(first, false);
+	SAL_Socket_SetBlocking(second, false);
+
+	relay = Allocate(SAL_Socket_RelayState);
+	relay->Lock = SAL_Mutex_Create();
+	relay->Sockets[0] = first;
+	relay->Sockets[1] = second;
+	relay->Counts[0] = 0;
+	relay->Counts[1] = 0;
+	relay->Result = 0;
+	relay->Callback = callback;
+	relay->State = state;
+
+	for (i = 0; i < 2; i++) {
+		operation = SAL_Socket_Operation_Begin(relay->Sockets[i], SAL_Socket_Operations_Relay, state);
+		operation->Relay = relay;
+		operation->Destination = relay->Sockets[1 - i];
+		operation->Readiness = true;
+		relay->Directions[i] = operation;
+
+		if (pipe2(operation->Pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+			operation->Pipe[0] = -1;
+			operation->Pipe[1] = -1;
+		}
+		else {
+			pipeSize = fcntl(operation->Pipe[1], F_GETPIPE_SZ);
+			operation->PipeSize = pipeSize > 0 ? (uint32)pipeSize : 65536;
+		}
+	}
+
+	SAL_Mutex_Acquire(relay->Lock);
+
+	if (relay->Directions[0]->Pipe[0] == -1 || relay->Directions[1]->Pipe[0] == -1) {
+		SAL_Mutex_Release(relay->Lock);
+		relay->Callback = NULL;
+		SAL_Socket_Relay_Finish(relay->Directions[0], -EMFILE);
+		return false;
+	}
+
+	for (i = 0; i < 2; i++)
+		relay->Sockets[i]->Entry->PendingRead = relay->Directions[i];
+
+	for (i = 0; i < 2; i++) {
+		if (!SAL_Socket_UpdateInterest(relay->Sockets[i])) {
+			SAL_Mutex_Release(relay->Lock);
+			relay->Callback = NULL;
+			SAL_Socket_Relay_Finish(relay->Directions[0], -EBADF);
+			return false;
+		}
+	}
+
+	SAL_Mutex_Release(relay->Lock);
+
+	return true;
+#endif
+}
+
+/**
+ * Accept a connection on @a listener without blocking the calling thread.
+ * @a callback is called on the listener's reactor thread with the new socket,
+ * or NULL if accepting failed.
+ *
+ * @param listener The listening socket to accept a connection on
+ * @param callback Called once a connection is accepted
+ * @param state Passed to @a callback
+ * @returns true if the accept was started
+ */
+boolean SAL_Socket_AcceptAsync(SAL_Socket* listener, SAL_Socket_AcceptCallback callback, void* const state) {
+	SAL_Socket_Operation* operation;
+
+	assert(listener != NULL);
+	assert(callback != NULL);
+	assert(listener->Entry->ReadCallback == NULL && listener->Entry->DataCallback == NULL);
+
+	operation = SAL_Socket_Operation_Begin(listener, SAL_Socket_Operations_Accept, state);
+	operation->AcceptCallback = callback;
+
+	if (!SAL_Socket_Operation_Submit(operation)) {
+		SAL_Socket_Operation_End(operation);
+		Free(operation);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Create a TCP connection to a host without waiting for the handshake.
+ * @a callback is called on the socket's reactor thread with the connected
+ * socket, or NULL if the connection failed; a failure before there was a
+ * socket, such as the name not resolving, is reported on a reactor thread too.
+ *
+ * A hostname that is not in the resolver cache is resolved by the resolver
+ * threads, and the connection started from there.
+ *
+ * @param address A string specifying the hostname to connect to
+ * @param port Port to connect to
+ * @param callback Called once the connection is established or has failed
+ * @param state Passed to @a callback
+ * @returns true if the connection was started, or is waiting on the
+ * resolver; false, without calling @a callback, if it failed straight away
+ */
+boolean SAL_Socket_ConnectAsync(const int8* const address, const int8* port, uint8 family, uint8 type, SAL_Socket_ConnectCallback callback, void* const state) {
+	SAL_Socket* server;
+	SAL_Socket_PendingConnect* pending;
+	struct addrinfo* serverAddrInfo;
+
+	assert(address != NULL || family == SAL_Socket_Families_Local);
+	assert(port != NULL);
+	assert(callback != NULL);
+
+#ifdef WINDOWS
+	if (!winsockInitialized) {
+		WSADATA startupData;
+		WSAStartup(514, &startupData);
+		winsockInitialized = true;
+	}
+#endif
+
+	if (!SAL_Socket_Resolve_Lookup(address, port, family, type, &serverAddrInfo)) {
+		pending = Allocate(SAL_Socket_PendingConnect);
+		pending->Family = family;
+		pending->Type = type;
+		pending->Timeout = 0;
+		pending->Callback = callback;
+		pending->State = state;
+
+		SAL_Socket_Resolve_Queue(address, port, family, type, SAL_Socket_ConnectAsync_Resolved, pending);
+
+		return true;
+	}
+
+	if (serverAddrInfo == NULL)
+		return false;
+
+	server = SAL_Socket_Open(serverAddrInfo, family, type);
+	if (server == NULL) {
+		SAL_Socket_Addresses_Free(serverAddrInfo);
+		return false;
+	}
+
+	return SAL_Socket_StartConnect(server, serverAddrInfo, callback, state);
+}
+
+/* the posted failure of a connect that waited on the resolver, run on a reactor */
+static void SAL_Socket_PendingConnect_Failed(void* const state) {
+	SAL_Socket_PendingConnect* pending;
+
+	pending = (SAL_Socket_PendingConnect*)state;
+	pending->Callback(NULL, pending->State);
 
-		SAL_Thread_Sleep(tries * 50);
+	Free(pending);
+}
+
+/* reports that a connect waiting on the resolver has failed. This runs on a resolver thread, so the callback is posted to a reactor and @a pending freed there. */
+static void SAL_Socket_PendingConnect_Fail(SAL_Socket_PendingConnect* pending) {
+	uint32 reactor;
+
+	reactor = SAL_Socket_Reactor_Next();
+
+	pending->Failure.Callback = SAL_Socket_PendingConnect_Failed;
+	pending->Failure.State = pending;
+	pending->Failure.Armed = false;
+	pending->Failure.Next = NULL;
+
+	SAL_Socket_Timer_Arm(&reactors[reactor], &pending->Failure, 0);
+}
+
+/* carries on with a connect once the resolver threads have resolved its name; a failure from here on is reported through the callback */
+static void SAL_Socket_ConnectAsync_Resolved(struct addrinfo* addresses, void* const state) {
+	SAL_Socket_PendingConnect* pending;
+	SAL_Socket* server;
+
+	pending = (SAL_Socket_PendingConnect*)state;
+
+	if (addresses == NULL) {
+		SAL_Socket_PendingConnect_Fail(pending);
+		return;
+	}
+
+	server = SAL_Socket_Open(addresses, pending->Family, pending->Type);
+	if (server == NULL) {
+		SAL_Socket_Addresses_Free(addresses);
+		SAL_Socket_PendingConnect_Fail(pending);
+		return;
 	}
 
+	if (!SAL_Socket_StartConnect(server, addresses, pending->Callback, pending->State)) {
+		SAL_Socket_PendingConnect_Fail(pending);
+		return;
+	}
 
-	return sentSoFar;
+	Free(pending);
+}
+
+/* starts connecting @a socket to the first of @a address, which the operation takes over. returns false, having closed the socket, if the connection could not be started. */
+static boolean SAL_Socket_StartConnect(SAL_Socket* socket, struct addrinfo* address, SAL_Socket_ConnectCallback callback, void* const state) {
+	SAL_Socket_Operation* operation;
+	int result;
+
+	operation = SAL_Socket_Operation_Begin(socket, SAL_Socket_Operations_Connect, state);
+	operation->AddressInfo = address;
+	operation->ConnectCallback = callback;
+
+	/* the epoll engine starts the connection here and waits for the socket to become writable */
+	if (asyncEngine == SAL_Socket_Engines_Epoll) {
+		SAL_Socket_SetBlocking(socket, false);
+
+		result = connect(socket->RawSocket, address->ai_addr, (int)address->ai_addrlen);
+		#ifdef WINDOWS
+			if (result != 0 && WSAGetLastError() != WSAEWOULDBLOCK)
+				goto error;
+		#elif defined POSIX
+			if (result != 0 && errno != EINPROGRESS)
+				goto error;
+		#endif
+	}
+
+	if (!SAL_Socket_Operation_Submit(operation))
+		goto error;
+
+	return true;
+
+error:
+	SAL_Socket_Operation_Release(operation);
+	SAL_Socket_Operation_End(operation);
+	Free(operation);
+	SAL_Socket_Close(socket);
+
+	return false;
 }
 
 /**
- * Register @a callback to be called whenever data is available on @a socket.
+ * Connect to @a address without blocking the calling thread on the
+ * connection, trying every address it resolves to rather than just the first.
+ * As RFC 8305 (Happy Eyeballs) describes, the addresses alternate between
+ * IPv6 and IPv4, starting with the family the resolver put first, and each
+ * attempt gets 250ms before the next is started alongside it; an attempt that
+ * fails starts the next at once. The first to connect wins and the others
+ * are abandoned.
  *
- * @param socket Socket to read from
- * @param callback The callback to call
+ * @param address A string specifying the hostname to connect to
+ * @param port Port to connect to
+ * @param family One of the SAL_Socket_Families_ values
+ * @param type One of the SAL_Socket_Types_ values
+ * @param timeout Milliseconds after which the attempts still running are
+ * given up, or 0 to leave that to the kernel. It starts once @a address is
+ * resolved.
+ * @param callback Called on a reactor thread with the connected socket, or
+ * with NULL if no address could be connected to in time
+ * @param state Passed to @a callback
+ * @returns false, without calling @a callback, if @a address is known not to
+ * resolve. A hostname that is not in the resolver cache is resolved by the
+ * resolver threads, and a failure to resolve it reported through @a callback.
+ */
+boolean SAL_Socket_ConnectHappyEyeballs(const int8* const address, const int8* port, uint8 family, uint8 type, uint32 timeout, SAL_Socket_ConnectCallback callback, void* const state) {
+	SAL_Socket_PendingConnect* pending;
+	struct addrinfo* addressInfo;
+
+	assert(address != NULL || family == SAL_Socket_Families_Local);
+	assert(port != NULL);
+	assert(callback != NULL);
+
+#ifdef WINDOWS
+	if (!winsockInitialized) {
+		WSADATA startupData;
+		WSAStartup(514, &startupData);
+		winsockInitialized = true;
+	}
+#endif
+
+	if (!SAL_Socket_Resolve_Lookup(address, port, family, type, &addressInfo)) {
+		pending = Allocate(SAL_Socket_PendingConnect);
+		pending->Family = family;
+		pending->Type = type;
+		pending->Timeout = timeout;
+		pending->Callback = callback;
+		pending->State = state;
+
+		SAL_Socket_Resolve_Queue(address, port, family, type, SAL_Socket_ConnectHappyEyeballs_Resolved, pending);
+
+		return true;
+	}
+
+	return SAL_Socket_Race_Start(addressInfo, type, timeout, callback, state);
+}
+
+static void SAL_Socket_ConnectHappyEyeballs_Resolved(struct addrinfo* addresses, void* const state) {
+	SAL_Socket_PendingConnect* pending;
+
+	pending = (SAL_Socket_PendingConnect*)state;
+
+	if (!SAL_Socket_Race_Start(addresses, pending->Type, pending->Timeout, pending->Callback, pending->State)) {
+		SAL_Socket_PendingConnect_Fail(pending);
+		return;
+	}
+
+	Free(pending);
+}
+
+/* races @a addresses, which it takes over, on a reactor. returns false if there are none. */
+static boolean SAL_Socket_Race_Start(struct addrinfo* addresses, uint8 type, uint32 timeout, SAL_Socket_ConnectCallback callback, void* const state) {
+	struct addrinfo* current;
+	struct addrinfo** resolved;
+	SAL_Socket_Race* race;
+	uint32 count;
+	uint32 i;
+	uint32 preferred;
+	uint32 other;
+
+	if (addresses == NULL)
+		return false;
+
+	for (count = 0, current = addresses; current != NULL; current = current->ai_next)
+		count++;
+
+	resolved = AllocateArray(struct addrinfo*, count);
+	for (i = 0, current = addresses; current != NULL; current = current->ai_next)
+		resolved[i++] = current;
+
+	race = Allocate(SAL_Socket_Race);
+	race->Addresses = AllocateArray(struct addrinfo*, count);
+	race->Attempts = AllocateArray(SAL_Socket_RaceAttempt, count);
+	race->Count = count;
+	race->Next = 0;
+	race->Running = 0;
+	race->Reactor = SAL_Socket_Reactor_Next();
+	race->Type = type;
+	race->Callback = callback;
+	race->State = state;
+	race->Stagger.Callback = SAL_Socket_Race_Next;
+	race->Stagger.State = race;
+	race->Stagger.Armed = false;
+	race->Deadline.Callback = SAL_Socket_Race_Expire;
+	race->Deadline.State = race;
+	race->Deadline.Armed = false;
+
+	/* alternates between the resolver's first family and the other, keeping the resolver's order within each */
+	for (i = 0, preferred = 0, other = 0; i < count; i++) {
+		while (preferred < count && resolved[preferred]->ai_family != addresses->ai_family)
+			preferred++;
+		while (other < count && resolved[other]->ai_family == addresses->ai_family)
+			other++;
+
+		if (other >= count || (preferred < count && i % 2 == 0))
+			race->Addresses[i] = resolved[preferred++];
+		else
+			race->Addresses[i] = resolved[other++];
+
+		race->Attempts[i].Race = race;
+		race->Attempts[i].Socket = NULL;
+	}
+
+	/* each address becomes a list of its own, which SAL_Socket_Addresses_Free accepts */
+	for (i = 0; i < count; i++)
+		resolved[i]->ai_next = NULL;
+
+	Free(resolved);
+
+	/* the race is started, and lives, on its reactor so that its attempts and timers never run at the same time */
+	if (timeout > 0)
+		SAL_Socket_Timer_Arm(&reactors[race->Reactor], &race->Deadline, timeout);
+
+	SAL_Socket_Timer_Arm(&reactors[race->Reactor], &race->Stagger, 0);
+
+	return true;
+}
+
+/* starts the next address that can be tried, and arms the stagger timer to start the one after; finishes the race if there are none left and nothing is running */
+static void SAL_Socket_Race_Next(void* const state) {
+	SAL_Socket_Race* race;
+	SAL_Socket_RaceAttempt* attempt;
+	struct addrinfo* address;
+	SAL_Socket* attemptSocket;
+
+	race = (SAL_Socket_Race*)state;
+
+	while (race->Next < race->Count) {
+		attempt = &race->Attempts[race->Next];
+		address = race->Addresses[race->Next];
+		race->Addresses[race->Next++] = NULL;
+
+		attemptSocket = SAL_Socket_Open(address, address->ai_family == AF_UNIX ? SAL_Socket_Families_Local : address->ai_family == AF_INET6 ? SAL_Socket_Families_IPV6 : SAL_Socket_Families_IPV4, race->Type);
+		if (attemptSocket == NULL) {
+			SAL_Socket_Addresses_Free(address);
+			continue;
+		}
+
+		attemptSocket->Reactor = race->Reactor;
+
+		if (!SAL_Socket_StartConnect(attemptSocket, address, SAL_Socket_Race_Connected, attempt))
+			continue;
+
+		attempt->Socket = attemptSocket;
+		race->Running++;
+
+		SAL_Socket_Timer_Arm(&reactors[race->Reactor], &race->Stagger, SAL_Socket_ConnectionAttemptDelay);
+
+		return;
+	}
+
+	if (race->Running == 0)
+		SAL_Socket_Race_Finish(race, NULL);
+}
+
+static void SAL_Socket_Race_Expire(void* const state) {
+	SAL_Socket_Race_Finish((SAL_Socket_Race*)state, NULL);
+}
+
+/* an attempt finished: the race is won, or the next address is tried without waiting out the stagger */
+static void SAL_Socket_Race_Connected(SAL_Socket* socket, void* const state) {
+	SAL_Socket_RaceAttempt* attempt;
+	SAL_Socket_Race* race;
+
+	attempt = (SAL_Socket_RaceAttempt*)state;
+	race = attempt->Race;
+
+	attempt->Socket = NULL;
+	race->Running--;
+
+	if (socket != NULL)
+		SAL_Socket_Race_Finish(race, socket);
+	else
+		SAL_Socket_Race_Next(race);
+}
+
+/* abandons the attempts still running, whose callbacks closing them suppresses, and reports @a winner */
+static void SAL_Socket_Race_Finish(SAL_Socket_Race* race, SAL_Socket* winner) {
+	uint32 i;
+
+	SAL_Socket_Timer_Disarm(&reactors[race->Reactor], &race->Stagger);
+	SAL_Socket_Timer_Disarm(&reactors[race->Reactor], &race->Deadline);
+
+	for (i = 0; i < race->Count; i++) {
+		if (race->Attempts[i].Socket != NULL)
+			SAL_Socket_Close(race->Attempts[i].Socket);
+
+		if (race->Addresses[i] != NULL)
+			SAL_Socket_Addresses_Free(race->Addresses[i]);
+	}
+
+	race->Callback(winner, race->State);
+
+	Free(race->Addresses);
+	Free(race->Attempts);
+	Free(race);
+}
+
+/**
+ * Accept every connection that arrives on @a listener until it is closed.
+ * @a callback is called on the listener's reactor thread with each new socket,
+ * and once more with NULL if accepting fails for good. The new sockets are
+ * spread across the reactors, so their own callbacks may run elsewhere.
+ *
+ * On the io_uring engine this is a single multishot accept; on the epoll
+ * engine the listener is made non-blocking and its backlog is drained each
+ * time it becomes ready.
  *
- * @warning The buffer passed to @a callback is the internal buffer. Do not reference it outside out the callback. 
+ * @param listener The listening socket to accept connections on
+ * @param callback Called for each accepted connection
+ * @param state Passed to @a callback
+ * @returns true if accepting was started
  */
-void SAL_Socket_SetReadCallback(SAL_Socket* socket, SAL_Socket_ReadCallback callback, void* const state) {
+boolean SAL_Socket_AcceptMultishot(SAL_Socket* listener, SAL_Socket_AcceptCallback callback, void* const state) {
+	SAL_Socket_Operation* operation;
+
+	assert(listener != NULL);
+	assert(callback != NULL);
+	assert(listener->Entry->ReadCallback == NULL && listener->Entry->DataCallback == NULL);
+
+	operation = SAL_Socket_Operation_Begin(listener, SAL_Socket_Operations_AcceptMultishot, state);
+	operation->AcceptCallback = callback;
+
+	if (!SAL_Socket_Operation_Submit(operation)) {
+		SAL_Socket_Operation_End(operation);
+		Free(operation);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Receive everything that arrives on @a socket until the connection ends,
+ * without giving the socket a buffer of its own. @a callback is called on
+ * the socket's reactor thread with each chunk of data, and once with a length
+ * of 0 when the peer closes the connection or receiving fails.
+ *
+ * On the io_uring engine this is a single multishot receive into a ring of
+ * buffers shared by every socket; on the epoll engine each reactor reads
+ * into one buffer of its own. Either way an idle connection holds no buffer.
+ *
+ * @param socket Socket to receive from
+ * @param callback Called for each chunk of data received
+ * @param state Passed to @a callback
+ * @returns true if receiving was started
+ *
+ * @warning @a data is only valid until @a callback returns.
+ */
+boolean SAL_Socket_ReceiveMultishot(SAL_Socket* socket, SAL_Socket_ReceiveCallback callback, void* const state) {
+	SAL_Socket_Operation* operation;
+
 	assert(socket != NULL);
 	assert(callback != NULL);
-	assert(state != NULL);
+	assert(socket->Entry->ReadCallback == NULL && socket->Entry->DataCallback == NULL);
+
+	operation = SAL_Socket_Operation_Begin(socket, SAL_Socket_Operations_ReceiveMultishot, state);
+	operation->ReceiveCallback = callback;
+
+	#ifdef POSIX
+		operation->Readiness = SAL_Socket_Reactor_Of(socket)->RingBuffers.Ring == NULL;
+	#endif
 
-	if (!asyncWorkerRunning) {
-		SAL_Socket_CallbackWorker_Initialize();
-		asyncWorkerRunning = true;
+	if (!SAL_Socket_Operation_Submit(operation)) {
+		SAL_Socket_Operation_End(operation);
+		Free(operation);
+		return false;
 	}
 
-	if (!socket->ReadCallback)
-		AsyncLinkedList_Append(&asyncSocketList, socket);
-	
-	socket->ReadCallback = callback;
-	socket->ReadCallbackState = state;
+	return true;
 }
 
 /**
- * Unregisters all callbacks for @a socket.
+ * Receive the data arriving on @a socket as a stream of frames, without
+ * blocking the calling thread. Data is read into a buffer of the socket's
+ * own, many frames at a time, and each complete frame is handed to
+ * @a callback as a slice of that buffer, however the frames were split
+ * across or packed into reads.
  *
- * @param socket The socket to clear all callbacks from
+ * @param socket Socket to receive from
+ * @param type How frames are delimited, one of the SAL_Frame_Types_ values
+ * @param delimiter For SAL_Frame_Types_Delimiter, the bytes that end each
+ * frame; ignored otherwise
+ * @param delimiterLength Length of @a delimiter, at most SAL_Frame_MaxDelimiter
+ * @param maxFrame The longest frame accepted; a longer one ends the receive
+ * @param callback Called on the socket's reactor thread with each frame,
+ * without its length prefix or delimiter, and with NULL and 0 once the
+ * connection ends or its data can't be framed
+ * @param state Passed to @a callback
+ * @returns true if the receive was started
+ *
+ * @warning The frame passed to @a callback points into the socket's buffer.
+ * Do not reference it outside of the callback. This counts as the socket's
+ * one outstanding read.
  */
-void SAL_Socket_UnsetSocketCallback(SAL_Socket* socket) {
+boolean SAL_Socket_ReceiveFrames(SAL_Socket* socket, uint8 type, const uint8* const delimiter, uint8 delimiterLength, uint32 maxFrame, SAL_Socket_ReceiveCallback callback, void* const state) {
+	SAL_Socket_Operation* operation;
+
 	assert(socket != NULL);
+	assert(callback != NULL);
 
-	if (socket->ReadCallback) {
-		socket->ReadCallback = NULL;
-		socket->ReadCallbackState = NULL;
-		
-		AsyncLinkedList_Remove(&asyncSocketList, socket);
+	operation = SAL_Socket_Operation_Begin(socket, SAL_Socket_Operations_ReceiveFrames, state);
+	operation->ReceiveCallback = callback;
+	operation->Reader = Allocate(SAL_Frame_Reader);
+	SAL_Frame_Reader_Initialize(operation->Reader, type, delimiter, delimiterLength, maxFrame);
+
+	/* it reads into the reader rather than the ring's buffers, so it runs on readiness under either engine */
+	operation->Readiness = true;
+
+	if (!SAL_Socket_Operation_Submit(operation)) {
+		SAL_Socket_Operation_Release(operation);
+		SAL_Socket_Operation_End(operation);
+		Free(operation);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Get the operating system's descriptor for @a socket, for the options and
+ * calls SAL doesn't wrap.
+ *
+ * @param socket The socket
+ * @returns the descriptor (a SOCKET under windows)
+ */
+uint64 SAL_Socket_GetDescriptor(SAL_Socket* socket) {
+	assert(socket != NULL);
+
+	return (uint64)socket->RawSocket;
+}
+
+/**
+ * @param socket The socket
+ * @returns the SAL_Socket_Families_ value @a socket was created with
+ */
+uint8 SAL_Socket_GetFamily(SAL_Socket* socket) {
+	assert(socket != NULL);
+
+	return socket->Family;
+}
+
+/**
+ * @param socket The socket
+ * @returns whether @a socket is connected, or listening
+ */
+boolean SAL_Socket_IsConnected(SAL_Socket* socket) {
+	assert(socket != NULL);
+
+	return socket->Connected;
+}
+
+/**
+ * Get the address of the peer of an accepted connection.
+ *
+ * @param socket The socket
+ * @returns SAL_Socket_AddressLength bytes, of which an IPv4 address takes the
+ * first 4, or all zero if the address isn't known
+ */
+const uint8* SAL_Socket_GetRemoteAddress(SAL_Socket* socket) {
+	assert(socket != NULL);
+
+	return socket->RemoteEndpointAddress;
+}
+
+/**
+ * Get a handle to @a socket that can be kept where a pointer could outlive it.
+ *
+ * @param socket The socket to get a handle to
+ * @returns the handle, which is never @ref SAL_Socket_InvalidHandle
+ */
+SAL_Socket_Handle SAL_Socket_GetHandle(SAL_Socket* socket) {
+	assert(socket != NULL);
+
+	return ((uint64)socket->Generation << 32) | socket->Slot;
+}
+
+/**
+ * Find the socket @a handle names.
+ *
+ * @param handle A handle from @ref SAL_Socket_GetHandle
+ * @returns the socket, or NULL if it has been closed since the handle was
+ * taken
+ *
+ * @warning The check is only as good as the moment it is made: a socket
+ * closed by another thread right after this returns is not caught.
+ */
+SAL_Socket* SAL_Socket_FromHandle(SAL_Socket_Handle handle) {
+	SAL_Socket* slab;
+	SAL_Socket* socket;
+	uint32 slot;
+	uint32 page;
+
+	slot = (uint32)handle;
+	page = slot >> SAL_Socket_Slab_Bits;
+	if (page >= SAL_Socket_Slab_Pages)
+		return NULL;
+
+#ifdef WINDOWS
+	slab = socketSlabs[page];
+	MemoryBarrier();
+#elif defined POSIX
+	slab = __atomic_load_n(&socketSlabs[page], __ATOMIC_ACQUIRE);
+#endif
+	if (slab == NULL)
+		return NULL;
+
+	socket = &slab[slot & (SAL_Socket_Slab_Size - 1)];
+
+	return socket->Generation == (uint32)(handle >> 32) ? socket : NULL;
+}
+
+/**
+ * Get the counts of the socket pool.
+ *
+ * @param stats Filled in with the counts
+ */
+void SAL_Socket_GetPoolStats(SAL_Socket_PoolStats* stats) {
+	uint32 live;
+
+	assert(stats != NULL);
+
+	live = socketsLive;
 
-		if (AsyncLinkedList_GetCount(&asyncSocketList) == 0)
-			SAL_Socket_CallbackWorker_Shutdown();
+	stats->Live = live;
+	stats->Free = socketSlabCount * SAL_Socket_Slab_Size - live;
+	stats->HighWater = socketsHighWater;
+}
+
+/**
+ * Set how long resolved addresses are kept for later connects to the same
+ * host and port, and how long a name that failed to resolve is remembered
+ * as failing. Literal addresses are parsed directly and never cached.
+ *
+ * @param ttl Milliseconds a resolved name is kept; 0 stops caching them
+ * @param negativeTtl Milliseconds a failure is kept; 0 stops caching them
+ *
+ * @warning Entries already in the cache keep the time they were given.
+ */
+void SAL_Socket_SetResolverCache(uint32 ttl, uint32 negativeTtl) {
+	resolverTTL = ttl;
+	resolverNegativeTTL = negativeTtl;
+}
+
+/**
+ * Resolve @a address without blocking on the resolver. Literal addresses and
+ * names in the resolver cache are answered straight away, before this
+ * returns; other names are resolved by the resolver threads, and lookups of
+ * a name that is already being resolved wait on that lookup rather than
+ * starting another.
+ *
+ * @param address A string specifying the hostname to resolve
+ * @param port Port the addresses are for
+ * @param family One of the SAL_Socket_Families_ values
+ * @param type One of the SAL_Socket_Types_ values
+ * @param callback Called with the addresses, which are only valid during the
+ * call, and how many there are; 0 if @a address did not resolve
+ * @param state Passed to @a callback
+ * @returns false, without calling @a callback, if @a family or @a type are
+ * not valid, or @a family is @ref SAL_Socket_Families_Local, which has no
+ * addresses to resolve to
+ */
+boolean SAL_Socket_ResolveAsync(const int8* const address, const int8* port, uint8 family, uint8 type, SAL_Socket_ResolveCallback callback, void* const state) {
+	SAL_Socket_PendingResolve* pending;
+	struct addrinfo hints;
+	struct addrinfo* addresses;
+
+	assert(address != NULL);
+	assert(port != NULL);
+	assert(callback != NULL);
+
+	if (!SAL_Socket_Resolve_Hints(family, type, &hints) || hints.ai_family == AF_UNIX)
+		return false;
+
+#ifdef WINDOWS
+	if (!winsockInitialized) {
+		WSADATA startupData;
+		WSAStartup(514, &startupData);
+		winsockInitialized = true;
+	}
+#endif
+
+	pending = Allocate(SAL_Socket_PendingResolve);
+	pending->Callback = callback;
+	pending->State = state;
+
+	if (SAL_Socket_Resolve_Lookup(address, port, family, type, &addresses))
+		SAL_Socket_ResolveAsync_Resolved(addresses, pending);
+	else
+		SAL_Socket_Resolve_Queue(address, port, family, type, SAL_Socket_ResolveAsync_Resolved, pending);
+
+	return true;
+}
+
+/* hands the addresses to the caller of SAL_Socket_ResolveAsync in the form it understands */
+static void SAL_Socket_ResolveAsync_Resolved(struct addrinfo* addresses, void* const state) {
+	SAL_Socket_PendingResolve pending;
+	SAL_Socket_Address* converted;
+	struct addrinfo* current;
+	uint32 count;
+
+	pending = *(SAL_Socket_PendingResolve*)state;
+	Free(state);
+
+	for (count = 0, current = addresses; current != NULL; current = current->ai_next)
+		count++;
+
+	converted = count > 0 ? AllocateArray(SAL_Socket_Address, count) : NULL;
+
+	for (count = 0, current = addresses; current != NULL; current = current->ai_next, count++) {
+		memset(&converted[count], 0, sizeof(SAL_Socket_Address));
+
+		/* an IPv4 address takes the first 4 bytes */
+		if (current->ai_family == AF_INET6) {
+			converted[count].Family = SAL_Socket_Families_IPV6;
+			converted[count].Port = ntohs(((struct sockaddr_in6*)current->ai_addr)->sin6_port);
+			memcpy(converted[count].Address, &((struct sockaddr_in6*)current->ai_addr)->sin6_addr, 16);
+		}
+		else {
+			converted[count].Family = SAL_Socket_Families_IPV4;
+			converted[count].Port = ntohs(((struct sockaddr_in*)current->ai_addr)->sin_port);
+			memcpy(converted[count].Address, &((struct sockaddr_in*)current->ai_addr)->sin_addr, 4);
+		}
+	}
+
+	pending.Callback(converted, count, pending.State);
+
+	if (converted != NULL)
+		Free(converted);
+
+	SAL_Socket_Addresses_Free(addresses);
+}
+
+/**
+ * Resolve names with @a resolver rather than getaddrinfo, such as to serve
+ * them from a hosts file or to stand in for a real resolver in a test. Names
+ * it resolves are cached like any other.
+ *
+ * @param resolver Fills in up to maxAddresses addresses for a host and
+ * returns how many it filled in; NULL goes back to getaddrinfo. Called on
+ * whichever thread needs the name, which is a resolver thread unless the
+ * blocking calls, such as @ref SAL_Socket_Connect, are used.
+ * @param state Passed to @a resolver
+ *
+ * @warning Names looked up through @a resolver must be given numeric ports.
+ */
+void SAL_Socket_SetResolver(SAL_Socket_ResolverFunction resolver, void* const state) {
+	SAL_Socket_Globals_Initialize();
+
+	SAL_RWLock_AcquireWrite(resolverLock);
+	resolverFunction = resolver;
+	resolverFunctionState = state;
+	SAL_RWLock_ReleaseWrite(resolverLock);
+}
+
+/**
+ * Forget every resolved name, so that the next connect to each resolves it
+ * again.
+ */
+void SAL_Socket_FlushResolverCache(void) {
+	SAL_Socket_Resolved* entry;
+	uint32 i;
+
+	SAL_Socket_Globals_Initialize();
+
+	SAL_RWLock_AcquireWrite(resolverLock);
+
+	for (i = 0; i < SAL_Socket_Resolver_Buckets; i++) {
+		while ((entry = resolverCache[i]) != NULL) {
+			resolverCache[i] = entry->Next;
+			SAL_Socket_Resolve_FreeEntry(entry);
+		}
 	}
+
+	resolverEntries = 0;
+
+	SAL_RWLock_ReleaseWrite(resolverLock);
+}
+
+/**
+ * Get the counts of the resolver cache.
+ *
+ * @param stats Filled in with the counts
+ */
+void SAL_Socket_GetResolverStats(SAL_Socket_ResolverStats* stats) {
+	assert(stats != NULL);
+
+	SAL_Socket_Globals_Initialize();
+
+	SAL_RWLock_AcquireRead(resolverLock);
+	*stats = resolverStats;
+	SAL_RWLock_ReleaseRead(resolverLock);
+
+	/* these are counted outside the write lock */
+	#ifdef WINDOWS
+		stats->Hits = (uint64)InterlockedCompareExchange64((volatile LONG64*)&resolverStats.Hits, 0, 0);
+		stats->Numeric = (uint64)InterlockedCompareExchange64((volatile LONG64*)&resolverStats.Numeric, 0, 0);
+		stats->Coalesced = (uint64)InterlockedCompareExchange64((volatile LONG64*)&resolverStats.Coalesced, 0, 0);
+	#elif defined POSIX
+		stats->Hits = __atomic_load_n(&resolverStats.Hits, __ATOMIC_RELAXED);
+		stats->Numeric = __atomic_load_n(&resolverStats.Numeric, __ATOMIC_RELAXED);
+		stats->Coalesced = __atomic_load_n(&resolverStats.Coalesced, __ATOMIC_RELAXED);
+	#endif
 }
 
 uint16 SAL_Socket_HostToNetworkShort(uint16 value) {
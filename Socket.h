@@ -2,44 +2,148 @@
 #define INCLUDE_SAL_SOCKET
 
 #include "Common.h"
+#include "Buffer.h"
+#include "Frame.h"
 
-/* forward declaration */
+/* opaque; see the accessors below */
 typedef struct SAL_Socket SAL_Socket;
 
 typedef void (*SAL_Socket_ReadCallback)(SAL_Socket* socket, void* const state);
+typedef void (*SAL_Socket_DataCallback)(SAL_Socket* socket, SAL_Buffer* buffer, const uint8* const data, const uint32 length, void* const state);
+typedef void (*SAL_Socket_CompletionCallback)(SAL_Socket* socket, int32 result, void* const state);
+typedef void (*SAL_Socket_AcceptCallback)(SAL_Socket* listener, SAL_Socket* accepted, void* const state);
+typedef void (*SAL_Socket_ConnectCallback)(SAL_Socket* socket, void* const state);
+typedef void (*SAL_Socket_ReceiveCallback)(SAL_Socket* socket, const uint8* const data, const uint32 length, void* const state);
+typedef void (*SAL_Socket_RelayCallback)(SAL_Socket* first, SAL_Socket* second, uint64 firstToSecond, uint64 secondToFirst, int32 result, void* const state);
+typedef void (*SAL_Socket_ZeroCopyCallback)(SAL_Socket* socket, uint32 first, uint32 last, boolean copied, void* const state);
 
 #define SAL_Socket_Families_IPV4 0
 #define SAL_Socket_Families_IPV6 1
 #define SAL_Socket_Families_IPAny 2
+#define SAL_Socket_Families_Local 3 /* a Unix domain socket on this host, named where the port would go: a path, or under Linux '@' and a name in the abstract namespace */
 
-#define SAL_Socket_Types_TCP 0 /* should probably add UDP eventually */
+#define SAL_Socket_Types_TCP 0 /* should probably add UDP eventually; a stream socket for SAL_Socket_Families_Local */
+#define SAL_Socket_Types_SeqPacket 1 /* messages that keep their boundaries, each read whole by a single read; SAL_Socket_Families_Local only, and not under Windows */
 
 #define SAL_Socket_AddressLength 16
 
-struct SAL_Socket {
+#define SAL_Socket_Engines_Epoll 0 /* select under Windows */
+#define SAL_Socket_Engines_IOUring 1
+
+#define SAL_Socket_ZeroCopyThreshold 16384 /* smaller writes are copied; pinning the pages costs more than copying them */
+#define SAL_Socket_ZeroCopy_None 0xFFFFFFFF
+
+#define SAL_Socket_InvalidHandle 0
+
+#define SAL_Socket_Status_Ok 0
+#define SAL_Socket_Status_WouldBlock 1 /* only on a non-blocking socket: nothing to read, or no room to write, right now */
+#define SAL_Socket_Status_Closed 2 /* the peer closed or reset the connection */
+#define SAL_Socket_Status_Error 3 /* see SAL_Socket_GetLastError */
+
+#define SAL_Socket_WriteQueueHighWatermark 65536 /* defaults for a write queue that was not given its own limits */
+#define SAL_Socket_WriteQueueLowWatermark 16384
+
+/* names a socket without pointing at it: the slot it occupies in the socket pool and the generation of that slot. Once the socket is closed the generation moves on, and @ref SAL_Socket_FromHandle no longer finds it. */
+typedef uint64 SAL_Socket_Handle;
+
+typedef struct {
+	uint32 Live; /* sockets in use */
+	uint32 Free; /* sockets allocated and waiting to be reused */
+	uint32 HighWater; /* the most sockets that were ever in use at once */
+} SAL_Socket_PoolStats;
+
+typedef struct {
+	uint64 Hits; /* lookups answered from the cache, remembered failures included */
+	uint64 Misses; /* lookups that went to the resolver */
+	uint64 Numeric; /* literal addresses, which skip the resolver and the cache */
+	uint64 Failures; /* resolutions that failed */
+	uint64 ResolveTime; /* milliseconds spent resolving, in total */
+	uint64 MaxResolveTime; /* the longest single resolution, in milliseconds */
+	uint64 Coalesced; /* lookups that waited on one of the same name already being resolved */
+} SAL_Socket_ResolverStats;
+
+#define SAL_Socket_ResolverMaxAddresses 16 /* the most addresses a SAL_Socket_ResolverFunction is asked for */
+
+/* an address a name resolved to */
+typedef struct {
+	uint8 Family; /* SAL_Socket_Families_IPV4 or SAL_Socket_Families_IPV6 */
+	uint16 Port;
+	uint8 Address[SAL_Socket_AddressLength]; /* an IPv4 address takes the first 4 bytes */
+} SAL_Socket_Address;
+
+typedef void (*SAL_Socket_ResolveCallback)(const SAL_Socket_Address* const addresses, uint32 count, void* const state);
+typedef uint32 (*SAL_Socket_ResolverFunction)(const int8* const host, uint8 family, SAL_Socket_Address* const addresses, uint32 maxAddresses, void* const state);
+
+/* one buffer of a scatter/gather read or write, laid out like the platform's own so that arrays of them go to the kernel as they are */
+typedef struct {
 	#ifdef WINDOWS
-		uint64 RawSocket;
+		uint32 Length;
+		uint8* Buffer;
 	#elif defined POSIX
-		int RawSocket;
+		uint8* Buffer;
+		size_t Length;
 	#endif
-	uint8 Type;
-	uint8 Family;
-	boolean Connected;
-	uint8 LastError;
-	uint8 RemoteEndpointAddress[SAL_Socket_AddressLength];
-	SAL_Socket_ReadCallback ReadCallback;
-	void* ReadCallbackState;
-};
+} SAL_Socket_IOVector;
 
 public SAL_Socket* SAL_Socket_Connect(const int8* const address, const int8* port, uint8 family, uint8 type);
 public SAL_Socket* SAL_Socket_Listen(const int8* const port, uint8 family, uint8 type);
+public uint32 SAL_Socket_ListenSharded(const int8* const port, uint8 family, uint8 type, SAL_Socket** listeners, boolean steer);
 public SAL_Socket* SAL_Socket_Accept(SAL_Socket* listener);
+public uint32 SAL_Socket_AcceptMany(SAL_Socket* listener, SAL_Socket** accepted, uint32 maxAccepted);
 public void SAL_Socket_Close(SAL_Socket* socket);
 public uint32 SAL_Socket_Read(SAL_Socket* socket, uint8* const buffer, const uint32 bufferSize);
 public uint32 SAL_Socket_Write(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount);
+public uint8 SAL_Socket_TryRead(SAL_Socket* socket, uint8* const buffer, const uint32 bufferSize, uint32* const read);
+public uint8 SAL_Socket_Peek(SAL_Socket* socket);
+public uint8 SAL_Socket_TryWrite(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, uint32* const written);
+public void SAL_Socket_SetNonBlocking(SAL_Socket* socket, boolean nonBlocking);
+public uint32 SAL_Socket_GetLastError(SAL_Socket* socket);
 public uint32 SAL_Socket_EnsureWrite(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, uint8 maxAttempts);
+public uint8 SAL_Socket_TryEnsureWrite(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, uint8 maxAttempts, uint32* const written);
+public uint32 SAL_Socket_ReadV(SAL_Socket* socket, SAL_Socket_IOVector* const vectors, const uint32 count);
+public uint8 SAL_Socket_TryReadV(SAL_Socket* socket, SAL_Socket_IOVector* const vectors, const uint32 count, uint32* const read);
+public uint32 SAL_Socket_WriteV(SAL_Socket* socket, const SAL_Socket_IOVector* const vectors, const uint32 count);
+public uint32 SAL_Socket_EnsureWriteV(SAL_Socket* socket, SAL_Socket_IOVector* vectors, uint32 count, uint8 maxAttempts);
+public boolean SAL_Socket_QueueWrite(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount);
+public void SAL_Socket_SetWriteQueue(SAL_Socket* socket, uint32 highWatermark, uint32 lowWatermark, SAL_Socket_CompletionCallback drainCallback, void* const state);
+public uint32 SAL_Socket_GetQueuedBytes(SAL_Socket* socket);
+public void SAL_Socket_Cork(SAL_Socket* socket);
+public boolean SAL_Socket_Flush(SAL_Socket* socket);
+public uint64 SAL_Socket_SendFile(SAL_Socket* socket, const int8* const path, uint64 offset, uint64 length);
+public boolean SAL_Socket_EnableZeroCopy(SAL_Socket* socket, SAL_Socket_ZeroCopyCallback callback, void* const state);
+public uint32 SAL_Socket_WriteZeroCopy(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, uint32* const sequence);
+public uint8 SAL_Socket_TryWriteZeroCopy(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, uint32* const sequence, uint32* const written);
 public void SAL_Socket_SetReadCallback(SAL_Socket* socket, SAL_Socket_ReadCallback callback, void* const state);
+public void SAL_Socket_SetDataCallback(SAL_Socket* socket, SAL_Socket_DataCallback callback, void* const state);
 public void SAL_Socket_UnsetSocketCallback(SAL_Socket* socket);
+public uint8 SAL_Socket_SetEngine(uint8 engine);
+public uint8 SAL_Socket_GetEngine(void);
+public uint32 SAL_Socket_SetReactorCount(uint32 count);
+public uint32 SAL_Socket_GetReactorCount(void);
+public void SAL_Socket_SetReactor(SAL_Socket* socket, uint32 reactor);
+public uint32 SAL_Socket_GetReactor(SAL_Socket* socket);
+public boolean SAL_Socket_ReadAsync(SAL_Socket* socket, uint8* const buffer, const uint32 bufferSize, SAL_Socket_CompletionCallback callback, void* const state);
+public boolean SAL_Socket_WriteAsync(SAL_Socket* socket, const uint8* const toWrite, const uint32 writeAmount, SAL_Socket_CompletionCallback callback, void* const state);
+public boolean SAL_Socket_SendFileAsync(SAL_Socket* socket, const int8* const path, uint64 offset, uint64 length, SAL_Socket_CompletionCallback callback, void* const state);
+public boolean SAL_Socket_Relay(SAL_Socket* first, SAL_Socket* second, SAL_Socket_RelayCallback callback, void* const state);
+public boolean SAL_Socket_AcceptAsync(SAL_Socket* listener, SAL_Socket_AcceptCallback callback, void* const state);
+public boolean SAL_Socket_ConnectAsync(const int8* const address, const int8* port, uint8 family, uint8 type, SAL_Socket_ConnectCallback callback, void* const state);
+public boolean SAL_Socket_ConnectHappyEyeballs(const int8* const address, const int8* port, uint8 family, uint8 type, uint32 timeout, SAL_Socket_ConnectCallback callback, void* const state);
+public boolean SAL_Socket_AcceptMultishot(SAL_Socket* listener, SAL_Socket_AcceptCallback callback, void* const state);
+public boolean SAL_Socket_ReceiveMultishot(SAL_Socket* socket, SAL_Socket_ReceiveCallback callback, void* const state);
+public boolean SAL_Socket_ReceiveFrames(SAL_Socket* socket, uint8 type, const uint8* const delimiter, uint8 delimiterLength, uint32 maxFrame, SAL_Socket_ReceiveCallback callback, void* const state);
+public uint64 SAL_Socket_GetDescriptor(SAL_Socket* socket);
+public uint8 SAL_Socket_GetFamily(SAL_Socket* socket);
+public boolean SAL_Socket_IsConnected(SAL_Socket* socket);
+public const uint8* SAL_Socket_GetRemoteAddress(SAL_Socket* socket);
+public SAL_Socket_Handle SAL_Socket_GetHandle(SAL_Socket* socket);
+public SAL_Socket* SAL_Socket_FromHandle(SAL_Socket_Handle handle);
+public void SAL_Socket_GetPoolStats(SAL_Socket_PoolStats* stats);
+public boolean SAL_Socket_ResolveAsync(const int8* const address, const int8* port, uint8 family, uint8 type, SAL_Socket_ResolveCallback callback, void* const state);
+public void SAL_Socket_SetResolver(SAL_Socket_ResolverFunction resolver, void* const state);
+public void SAL_Socket_SetResolverCache(uint32 ttl, uint32 negativeTtl);
+public void SAL_Socket_FlushResolverCache(void);
+public void SAL_Socket_GetResolverStats(SAL_Socket_ResolverStats* stats);
 public uint16 SAL_Socket_HostToNetworkShort(uint16 value);
 public uint16 SAL_Socket_NetworkToHostShort(uint16 value);
 
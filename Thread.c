@@ -2,6 +2,7 @@
  * @file Thread.c
  * @brief Threading functions and synchronization primitives.
  */
+#define _GNU_SOURCE /* pthread_setaffinity_np */
 
 #include "Thread.h"
 
@@ -10,6 +11,8 @@
 	#include <Windows.h>
 #elif defined POSIX
 	#include <errno.h>
+	#include <time.h>
+	#include <unistd.h>
 #endif
 
 /**
@@ -70,7 +73,12 @@ void SAL_Thread_Sleep(uint32 duration) {
 #ifdef WINDOWS
 	Sleep(duration);
 #elif defined POSIX
-	sleep(duration);
+	struct timespec remaining;
+
+	remaining.tv_sec = duration / 1000;
+	remaining.tv_nsec = (duration % 1000) * 1000000;
+
+	while (nanosleep(&remaining, &remaining) == -1 && errno == EINTR);
 #endif
 }
 
@@ -87,6 +95,52 @@ void SAL_Thread_Exit(uint32 exitCode) {
 #endif
 }
 
+/**
+ * @returns the number of processors the system has online, at least 1
+ */
+uint32 SAL_Thread_GetProcessorCount(void) {
+#ifdef WINDOWS
+	SYSTEM_INFO systemInfo;
+
+	GetSystemInfo(&systemInfo);
+
+	return systemInfo.dwNumberOfProcessors > 0 ? (uint32)systemInfo.dwNumberOfProcessors : 1;
+#elif defined POSIX
+	long count;
+
+	count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return count > 0 ? (uint32)count : 1;
+#endif
+}
+
+/**
+ * Restrict @a thread to run only on @a processor.
+ *
+ * @param thread The thread to restrict
+ * @param processor Index of the processor, below
+ * @ref SAL_Thread_GetProcessorCount
+ * @returns true if the affinity was set
+ */
+boolean SAL_Thread_SetAffinity(SAL_Thread thread, uint32 processor) {
+#ifdef WINDOWS
+	if (processor >= sizeof(DWORD_PTR) * 8)
+		return false;
+
+	return SetThreadAffinityMask(thread, (DWORD_PTR)1 << processor) != 0;
+#elif defined POSIX
+	cpu_set_t processors;
+
+	if (processor >= CPU_SETSIZE)
+		return false;
+
+	CPU_ZERO(&processors);
+	CPU_SET(processor, &processors);
+
+	return pthread_setaffinity_np(thread, sizeof(processors), &processors) == 0;
+#endif
+}
+
 /**
  * Create a new mutex.
  *
@@ -125,6 +179,7 @@ SAL_Mutex SAL_Mutex_Create(void) {
 uint8 SAL_Mutex_Free(SAL_Mutex mutex) {
 #ifdef WINDOWS
 	DeleteCriticalSection((CRITICAL_SECTION*)mutex);
+	Free(mutex);
 	return 0;
 #elif defined POSIX
 	int status;
@@ -132,6 +187,7 @@ uint8 SAL_Mutex_Free(SAL_Mutex mutex) {
 	if (status == EBUSY) {
 		return 1;
 	}
+	Free(mutex);
 	return 0;
 #endif
 }
@@ -164,6 +220,98 @@ void SAL_Mutex_Release(SAL_Mutex mutex) {
 #endif
 }
 
+/**
+ * Create a new reader-writer lock, which any number of readers can hold at
+ * once, or a single writer.
+ *
+ * The created lock should be freed with @ref SAL_RWLock_Free.
+ *
+ * @returns a new lock
+ */
+SAL_RWLock SAL_RWLock_Create(void) {
+#ifdef WINDOWS
+	SRWLOCK* lock;
+
+	lock = Allocate(SRWLOCK);
+	InitializeSRWLock(lock);
+
+	return (SAL_RWLock)lock;
+#elif defined POSIX
+	pthread_rwlock_t* lock;
+
+	lock = Allocate(pthread_rwlock_t);
+	pthread_rwlock_init(lock, NULL);
+
+	return lock;
+#endif
+}
+
+/**
+ * Frees @a lock.
+ *
+ * @param lock lock to free
+ *
+ * @warning The lock must not be held.
+ */
+void SAL_RWLock_Free(SAL_RWLock lock) {
+#ifdef POSIX
+	pthread_rwlock_destroy(lock);
+#endif
+	Free(lock);
+}
+
+/**
+ * Acquire @a lock for reading, blocking while a writer holds it.
+ *
+ * @param lock lock to acquire
+ */
+void SAL_RWLock_AcquireRead(SAL_RWLock lock) {
+#ifdef WINDOWS
+	AcquireSRWLockShared((SRWLOCK*)lock);
+#elif defined POSIX
+	pthread_rwlock_rdlock(lock);
+#endif
+}
+
+/**
+ * Release a read hold on @a lock.
+ *
+ * @param lock lock to release
+ */
+void SAL_RWLock_ReleaseRead(SAL_RWLock lock) {
+#ifdef WINDOWS
+	ReleaseSRWLockShared((SRWLOCK*)lock);
+#elif defined POSIX
+	pthread_rwlock_unlock(lock);
+#endif
+}
+
+/**
+ * Acquire @a lock for writing, blocking while anyone else holds it.
+ *
+ * @param lock lock to acquire
+ */
+void SAL_RWLock_AcquireWrite(SAL_RWLock lock) {
+#ifdef WINDOWS
+	AcquireSRWLockExclusive((SRWLOCK*)lock);
+#elif defined POSIX
+	pthread_rwlock_wrlock(lock);
+#endif
+}
+
+/**
+ * Release a write hold on @a lock.
+ *
+ * @param lock lock to release
+ */
+void SAL_RWLock_ReleaseWrite(SAL_RWLock lock) {
+#ifdef WINDOWS
+	ReleaseSRWLockExclusive((SRWLOCK*)lock);
+#elif defined POSIX
+	pthread_rwlock_unlock(lock);
+#endif
+}
+
 /**
  * Create a new semaphore.
  *
@@ -211,6 +359,35 @@ void SAL_Semaphore_Decrement(SAL_Semaphore semaphore) {
 #endif
 }
 
+/**
+ * Decrement a semaphore, waiting at most @a milliseconds for its count to
+ * become non-zero.
+ *
+ * @param semaphore to decrement
+ * @param milliseconds Longest time to wait
+ * @returns true if the semaphore was decremented, false if it timed out
+ */
+boolean SAL_Semaphore_DecrementTimeout(SAL_Semaphore semaphore, uint32 milliseconds) {
+#ifdef WINDOWS
+	return WaitForSingleObject(semaphore, milliseconds) == WAIT_OBJECT_0;
+#elif defined POSIX
+	struct timespec deadline;
+	int result;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += milliseconds / 1000;
+	deadline.tv_nsec += (milliseconds % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	while ((result = sem_timedwait(semaphore, &deadline)) == -1 && errno == EINTR);
+
+	return result == 0;
+#endif
+}
+
 /**
  * Increment a semaphore.
  * 
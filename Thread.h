@@ -8,6 +8,7 @@
 	typedef unsigned long (__stdcall *SAL_Thread_StartAddress)(void* SAL_Thread_StartArgument);
 	typedef void* SAL_Thread;
 	typedef void* SAL_Mutex;
+	typedef void* SAL_RWLock;
 	typedef void* SAL_Semaphore;
 #elif defined POSIX
 	#include <pthread.h>
@@ -18,6 +19,7 @@
 	typedef pthread_t SAL_Thread;
 
 	typedef pthread_mutex_t* SAL_Mutex;
+	typedef pthread_rwlock_t* SAL_RWLock;
 	typedef sem_t* SAL_Semaphore;
 #endif
 
@@ -26,15 +28,25 @@ public uint64 SAL_Thread_Join(SAL_Thread thread);
 public void SAL_Thread_Yield(void);
 public void SAL_Thread_Sleep(uint32 duration);
 public void SAL_Thread_Exit(uint32 exitCode);
+public uint32 SAL_Thread_GetProcessorCount(void);
+public boolean SAL_Thread_SetAffinity(SAL_Thread thread, uint32 processor);
 
 public SAL_Mutex SAL_Mutex_Create(void);
 public uint8 SAL_Mutex_Free(SAL_Mutex mutex);
 public void SAL_Mutex_Acquire(SAL_Mutex mutex);
 public void SAL_Mutex_Release(SAL_Mutex mutex);
 
+public SAL_RWLock SAL_RWLock_Create(void);
+public void SAL_RWLock_Free(SAL_RWLock lock);
+public void SAL_RWLock_AcquireRead(SAL_RWLock lock);
+public void SAL_RWLock_ReleaseRead(SAL_RWLock lock);
+public void SAL_RWLock_AcquireWrite(SAL_RWLock lock);
+public void SAL_RWLock_ReleaseWrite(SAL_RWLock lock);
+
 public SAL_Semaphore SAL_Semaphore_Create(void);
 public void SAL_Semaphore_Free(SAL_Semaphore Semaphore);
 public void SAL_Semaphore_Decrement(SAL_Semaphore Semaphore);
+public boolean SAL_Semaphore_DecrementTimeout(SAL_Semaphore Semaphore, uint32 milliseconds);
 public void SAL_Semaphore_Increment(SAL_Semaphore Semaphore);
 
 #endif